@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// --- Adaptive Sensor Polling ---
+// Picks the next sample time from how fast the reading is moving: the goal
+// is roughly one sensor resolution step of change between samples. Fast
+// changes (or a relay switch, via kick()) drop straight to minIntervalMs;
+// when things settle the interval backs off by at most 2x per sample, up to
+// maxIntervalMs. minIntervalMs should be the fastest the sensor can deliver
+// a fresh reading.
+class AdaptiveSampler {
+public:
+  AdaptiveSampler(uint32_t minIntervalMs, uint32_t maxIntervalMs, float resolution);
+
+  bool due(uint32_t nowMs) const;
+
+  /**
+   * @brief Record a sample that was just taken. Pass invalid readings too
+   * (<= -99); they count as taken but don't move the rate estimate. Failed
+   * reads in a row double the interval, up to maxIntervalMs.
+   */
+  void sampled(uint32_t nowMs, float value);
+
+  /**
+   * @brief Something just changed upstream (e.g. the relay switched), sample
+   * at the minimum interval again.
+   */
+  void kick();
+
+  uint32_t interval() const { return intervalMs; }
+  uint32_t taken() const { return samplesTaken; }
+  // samples a fixed poll at minIntervalMs would have taken but we didn't
+  uint32_t skipped() const { return samplesSkipped; }
+
+private:
+  uint32_t minIntervalMs;
+  uint32_t maxIntervalMs;
+  float    resolution;
+
+  uint32_t intervalMs;
+  uint32_t lastSampleMs = 0;
+  float    lastValue = 0.0;
+  float    ratePerS = 0.0;  // smoothed |dv/dt|
+  bool     started = false;
+  bool     haveValue = false;
+  uint8_t  failedInRow = 0;
+
+  uint32_t samplesTaken = 0;
+  uint32_t samplesSkipped = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include "TrendStore.h"
+
+// --- Enclosure Control Logic ---
+// Menu handling, sensor processing, heater/fan control and the display
+// contents. Talks to the hardware only through Hal.h so the exact same code
+// runs on the ESP32 and in the host replay harness.
+
+const int NUM_MENU_ITEMS = 6;
+const int DISPLAY_VALUE_CHARS = 20;
+
+// Fixed left part of each menu line. These never change, so the renderer
+// rasterizes them once and only draws the values each frame.
+extern const char* const MENU_LABELS[NUM_MENU_ITEMS];
+
+// What the screen should show; main.cpp turns this into pixels
+struct DisplayModel {
+  int  selectedLine;
+  bool trendScreen;   // pressed on "Current Temp", show the trend graph instead of the menu
+  int  trendChannel;
+  int  trendTier;
+  char values[NUM_MENU_ITEMS][DISPLAY_VALUE_CHARS]; // shown to the right of MENU_LABELS[i]
+};
+
+struct ControllerOutputs {
+  bool     relay;
+  int      fanDuty;
+  uint32_t displayHash; // covers the display model and the trend data it shows
+};
+
+void controllerSetup();
+void controllerLoop();
+
+const DisplayModel& controllerDisplay();
+const ControllerOutputs& controllerOutputs();
+
+extern TrendStore trendStore;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+// --- Hardware Abstraction ---
+// Everything the control logic in Controller.cpp needs from the outside
+// world. main.cpp implements these on the ESP32 (and records every input to
+// the trace); the replay harness in tools/replay implements them from a
+// recorded trace. Controller.cpp must not touch hardware or millis() directly,
+// otherwise a replay can no longer reproduce it.
+
+// Inputs sampled once at the start of every loop pass
+struct LoopInputs {
+  uint32_t nowMs;
+  long     encoderValue;
+  bool     buttonPressed; // a debounced press happened since the last pass
+};
+
+void     halReadLoopInputs(LoopInputs& in);
+uint16_t halReadNtcRaw();                         // one ADC conversion
+void     halReadDht(float& tempC, float& humidity); // NAN on a failed read
+
+void halSetRelay(bool on);
+void halSetFanDuty(int percent);
+void halSetEncoderBounds(long minValue, long maxValue, bool circleValues);
+void halSetEncoderValue(long value);
+void halDelay(uint32_t ms);
+void halLog(const char* fmt, ...);
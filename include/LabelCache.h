@@ -0,0 +1,44 @@
+#pragma once
+
+#include <U8g2lib.h>
+#include "Controller.h"
+
+// --- Menu Label Cache ---
+// The menu labels never change, so each one is rasterized once in setup() and
+// kept as a copy of the framebuffer bytes it covers, in both the normal and the
+// highlighted (selected line) version. A frame then copies the label bytes into
+// the buffer and only runs the font renderer for the value, which is drawn in
+// a fixed slot starting at the first byte boundary right of the label.
+class LabelCache {
+public:
+  /**
+   * @brief Rasterize all MENU_LABELS with the current font. Uses the
+   * framebuffer as scratch space, so call it before the first frame.
+   * @param lineHeight Height of one menu line band, line i starts at i * lineHeight.
+   * @param textX      Left edge of the label text.
+   * @param baselines  Text baseline of each line.
+   */
+  void begin(U8G2& u8g2, int lineHeight, int textX, const int* baselines);
+
+  /**
+   * @brief Copy label `line` into its band. The selected version includes the
+   * highlight box under the label; the caller fills the rest of the band.
+   * Lines must be blitted top to bottom, like the text pass they replace.
+   */
+  void blit(U8G2& u8g2, int line, bool selected) const;
+
+  /**
+   * @brief First pixel column of the value slot of `line` (byte aligned).
+   */
+  int valueX(int line) const { return labelBytes[line] * 8; }
+
+private:
+  static const int MAX_LINE_HEIGHT = 12;
+  static const int OVERHANG_ROWS = 3;    // descenders reach into the next line's band
+  static const int MAX_LABEL_BYTES = 12; // 96 px, leaves at least 32 px for the value
+
+  int lineHeight = 0;
+  int labelBytes[NUM_MENU_ITEMS] = {};
+  int labelRows[NUM_MENU_ITEMS] = {};    // band plus the overhang that fits on the screen
+  uint8_t bitmaps[NUM_MENU_ITEMS][2][MAX_LINE_HEIGHT + OVERHANG_ROWS][MAX_LABEL_BYTES];
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+
+// --- Predictive Heater Control ---
+// Two-node lumped thermal model of the heater core (H) and the enclosure (E):
+//
+//   dH/dt = heatGain * u - coreLoss * (H - E)
+//   dE/dt = coupling * (H - E) - encLoss * E + encBias      (encBias = encLoss * ambient)
+//
+// where u is the relay state (0/1). The coefficients are learned online with
+// recursive least squares from the NTC and DHT readings. Once trained, the
+// controller simulates "what if the relay turned off now" to cut the heater
+// before the stored heat in the core overshoots the setpoint, and switches it
+// on early when the enclosure is predicted to sag below the setpoint.
+
+// Small recursive least squares estimator with exponential forgetting.
+template <int N>
+struct RlsEstimator {
+  float theta[N];
+  float P[N][N];
+
+  void reset(const float initial[N], float variance) {
+    for (int i = 0; i < N; ++i) {
+      theta[i] = initial[i];
+      for (int j = 0; j < N; ++j) P[i][j] = (i == j) ? variance : 0.0;
+    }
+  }
+
+  // Forgetting is suspended once the covariance trace reaches maxTrace, so
+  // long steady-state stretches (no excitation) can't wind the estimate up.
+  void update(const float x[N], float y, float forget, float maxTrace) {
+    float trace = 0.0;
+    for (int i = 0; i < N; ++i) trace += P[i][i];
+    if (trace >= maxTrace) forget = 1.0;
+
+    float Px[N];
+    float denom = forget;
+    for (int i = 0; i < N; ++i) {
+      Px[i] = 0.0;
+      for (int j = 0; j < N; ++j) Px[i] += P[i][j] * x[j];
+      denom += x[i] * Px[i];
+    }
+    float err = y;
+    for (int i = 0; i < N; ++i) err -= theta[i] * x[i];
+    for (int i = 0; i < N; ++i) theta[i] += Px[i] * err / denom;
+    for (int i = 0; i < N; ++i)
+      for (int j = 0; j < N; ++j) P[i][j] = (P[i][j] - Px[i] * Px[j] / denom) / forget;
+  }
+};
+
+class PredictiveHeater {
+public:
+  /**
+   * @brief Feed a sensor reading into the model. Invalid readings (<= -99) are ignored.
+   */
+  void observe(uint32_t nowMs, float heaterC, float enclosureC, bool relayOn);
+
+  /**
+   * @brief Relay decision for the given setpoint and current temperatures.
+   * Falls back to plain on/off control until enough data has been collected
+   * to trust the model, or when there is no heater core reading.
+   */
+  bool decide(uint32_t nowMs, float setpointC, bool relayOn, float heaterC, float enclosureC);
+
+  bool trained() const { return trainedWindows >= MIN_TRAINED_WINDOWS; }
+
+  /**
+   * @brief Highest enclosure temperature reached over the horizon if the
+   * relay were switched off now, ignoring the first startStep sim steps.
+   */
+  float coastPeak(float heaterC, float enclosureC, int startStep = 0) const;
+
+  /**
+   * @brief Advance an enclosure temperature estimate by dtS seconds given the
+   * measured heater core temperature. Used when the enclosure sensor drops out.
+   */
+  float stepEnclosure(float enclosureC, float heaterC, float dtS) const;
+
+  /**
+   * @brief Replace the learned coefficients (e.g. with ones saved from an
+   * earlier run) and treat the model as trained. Learning continues from here.
+   */
+  void setModel(float heatGain, float coreLoss, float coupling, float encLoss, float encBias);
+
+  PredictiveHeater();
+
+  float heatGain() const { return core.theta[0]; } // C/s of core heating with the relay on
+  float coreLoss() const { return core.theta[1]; } // 1/s
+  float coupling() const { return enc.theta[0]; }  // 1/s
+  float encLoss()  const { return enc.theta[1]; }  // 1/s
+  float encBias()  const { return enc.theta[2]; }  // C/s, encLoss * ambient
+
+private:
+  static const uint32_t LEARN_WINDOW_MS = 30000;
+  static const int      MIN_TRAINED_WINDOWS = 10;
+  static const uint32_t MIN_SWITCH_MS = 15000; // relay chatter guard
+  static const int      SIM_STEP_S = 5;         // substepped when the model is fast (see coastPeak)
+  static const int      SIM_STEPS = 240;        // 20 minute horizon
+  static const int      LEAD_STEPS = 12;        // 60 s: how long the core takes to reach the enclosure
+  static constexpr float HYSTERESIS_C = 0.5;
+  static constexpr float FORGET = 0.98;
+
+  RlsEstimator<2> core;
+  RlsEstimator<3> enc;
+
+  void learn(float dt, float dH, float dE, float duty);
+  void clampModel();
+
+  bool     haveWindow = false;
+  uint32_t windowStartMs = 0;
+  uint32_t lastObserveMs = 0;
+  uint32_t relayOnMs = 0;
+  float    windowH = 0.0;
+  float    windowE = 0.0;
+  bool     lastRelay = false;
+  int      trainedWindows = 0;
+
+  float    heaterC = -99.9;    // latest observed, for learning
+  float    enclosureC = -99.9;
+  uint32_t lastSwitchMs = 0;
+  bool     haveSwitched = false;
+};
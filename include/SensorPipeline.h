@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+// --- Sensor Processing ---
+// Each sensor reading goes through a SensorChannel before the controller uses
+// it. A Hampel filter rejects readings that sit too far from the median of the
+// recent accepted ones, unless several rejected readings in a row line up
+// with each other (a real step or a fast ramp). The channel also tracks how old
+// the last good value is, so a dropout shows up as a health state instead of a
+// -99 sentinel.
+
+enum SensorHealth {
+  SENSOR_NO_DATA = 0, // never had a good reading
+  SENSOR_OK,          // last read was good and recent
+  SENSOR_STALE,       // recent reads failed or were rejected, the last good value is still usable
+  SENSOR_FAILED,      // no good reading for failedMs
+};
+
+struct SensorConfig {
+  uint32_t staleMs;   // a good value older than this is stale even if nothing failed
+  uint32_t failedMs;  // no good value for this long and the sensor counts as gone
+  float    minSpread; // outlier threshold never drops below this (sensor resolution/noise)
+};
+
+class SensorChannel {
+public:
+  explicit SensorChannel(const SensorConfig& config);
+
+  /**
+   * @brief Feed one reading, NAN for a failed read. Returns true if it was accepted.
+   */
+  bool update(uint32_t nowMs, float value);
+
+  float value() const { return lastGood; }
+  SensorHealth health(uint32_t nowMs) const;
+  uint32_t ageMs(uint32_t nowMs) const { return nowMs - lastGoodMs; }
+
+  uint32_t rejected() const { return rejectedCount; }
+  uint32_t failedReads() const { return failedCount; }
+
+private:
+  static const int WINDOW = 7;
+  static const int MAX_CONSECUTIVE_REJECTS = 3; // this many in a row that line up are a real change, not outliers
+  static constexpr float HAMPEL_K = 3.0;
+
+  void accept(uint32_t nowMs, float value);
+
+  SensorConfig config;
+  float    history[WINDOW];
+  int      historyCount = 0;
+  int      historyHead = 0;
+  float    rejects[MAX_CONSECUTIVE_REJECTS]; // the current run of rejected values, oldest first
+  int      rejectCount = 0;
+  bool     lastReadBad = false;
+
+  float    lastGood = -99.9;
+  uint32_t lastGoodMs = 0;
+  bool     haveGood = false;
+
+  uint32_t rejectedCount = 0;
+  uint32_t failedCount = 0;
+};
+
+/**
+ * @brief Median of a burst of raw ADC codes (reorders the array).
+ */
+uint16_t medianOf(uint16_t* values, int n);
+
+/**
+ * @brief Median of n floats (reorders the array).
+ */
+float medianOf(float* values, int n);
+
+const char* sensorHealthName(SensorHealth health);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+// --- Setpoint Profiles ---
+// A profile is a list of steps. Each step ramps linearly from the previous
+// setpoint to its own setpoint over rampMs, then holds it for holdMs.
+// A step with a lower setpoint than the one before it is a cooldown.
+struct ProfileStep {
+  float    setpointC;
+  uint32_t rampMs;
+  uint32_t holdMs;
+};
+
+struct Profile {
+  const char*        name;
+  const ProfileStep* steps;
+  uint8_t            numSteps;
+};
+
+extern const Profile BUILTIN_PROFILES[];
+extern const int NUM_BUILTIN_PROFILES;
+
+class ProfileRunner {
+public:
+  /**
+   * @brief Start running a profile.
+   * @param startTempC Setpoint the first ramp starts from (usually the current enclosure temp).
+   */
+  void start(const Profile* profile, float startTempC, uint32_t nowMs);
+  void stop();
+
+  bool active() const { return profile != nullptr; }
+  const Profile* current() const { return profile; }
+  uint8_t currentStep() const { return stepIndex; }
+
+  /**
+   * @brief Setpoint for the given time. Advances through the steps and
+   * stops the profile once the last hold has elapsed.
+   */
+  float setpointAt(uint32_t nowMs);
+
+private:
+  const Profile* profile = nullptr;
+  uint8_t  stepIndex = 0;
+  uint32_t stepStartMs = 0;
+  float    stepFromC = 0.0;
+  float    lastSetpointC = 0.0;
+};
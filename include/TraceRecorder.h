@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Input Trace Recording ---
+// Compact binary log of every external input the controller sees, in the
+// order it saw them, plus the resulting outputs whenever they change. A
+// trace is a 5 byte header ("ENCT" + version) followed by events. Each event
+// starts with one byte: the low 3 bits are the type, the upper bits are flags.
+//
+//   TICK    flags: encoder changed, button     varint dt ms [, zigzag encoder delta]
+//   NTC                                        zigzag delta from the previous raw code
+//   DHT     flags: temp valid, humidity valid  [zigzag temp x10] [zigzag humidity x10]
+//   OUT     flags: relay                        varint fan %, 4 byte display hash
+//   REPEAT                                     varint n
+//
+// REPEAT stands for n more idle TICKs (no encoder change, no button) with the
+// same dt as the last TICK; the reader hands them out as TICKs. An idle loop
+// pass at a steady rate costs nothing, a run is only written out when another
+// event has to go in after it.
+
+enum TraceEventType {
+  TRACE_NONE = 0,
+  TRACE_TICK = 1,
+  TRACE_NTC  = 2,
+  TRACE_DHT  = 3,
+  TRACE_OUT  = 4,
+};
+
+struct TraceEvent {
+  uint8_t  type;
+  uint32_t nowMs;     // TICK
+  long     encoder;   // TICK
+  bool     button;    // TICK
+  uint16_t ntcRaw;    // NTC
+  float    tempC;     // DHT, NAN if invalid
+  float    humidity;  // DHT, NAN if invalid
+  bool     relay;     // OUT
+  int      fanDuty;   // OUT
+  uint32_t displayHash; // OUT
+};
+
+class TraceWriter {
+public:
+  // returns how many bytes it actually stored
+  typedef size_t (*Sink)(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Start a new trace. Recording stops (and truncated() turns true)
+   * once maxBytes have been handed to the sink, or the sink stores less than
+   * it was given (storage full).
+   */
+  void begin(Sink sink, uint32_t maxBytes);
+
+  void tick(uint32_t nowMs, long encoder, bool button);
+  void ntc(uint16_t raw);
+  // pass values already run through quantizeDht()
+  void dht(float tempC, float humidity);
+  // only logged when something differs from the last logged outputs
+  void outputs(bool relay, int fanDuty, uint32_t displayHash);
+
+  void flush();
+  bool truncated() const { return full; }
+  uint32_t bytesWritten() const { return written + used; }
+
+  /**
+   * @brief Round a DHT reading to what the trace stores (0.1 steps). The
+   * firmware must use the quantized value so a replay sees exactly the same input.
+   */
+  static float quantizeDht(float value);
+
+private:
+  void put(uint8_t b);
+  void putVarint(uint32_t v);
+  void putSigned(int32_t v);
+  void endEvent();
+  void flushRepeats(); // before any other event, so the order is kept
+
+  Sink     sink = nullptr;
+  uint32_t maxBytes = 0;
+  uint32_t written = 0;
+  bool     full = false;
+
+  uint8_t  buf[256];
+  size_t   used = 0;
+  size_t   eventStart = 0;
+
+  uint32_t lastNowMs = 0;
+  long     lastEncoder = 0;
+  uint16_t lastNtc = 0;
+  uint32_t lastTickDt = 0;
+  bool     canRepeat = false;    // a TICK has been written, lastTickDt is valid
+  uint32_t pendingRepeats = 0;   // idle TICKs not yet written as a REPEAT
+  bool     haveOutputs = false;
+  bool     lastRelay = false;
+  int      lastFan = 0;
+  uint32_t lastHash = 0;
+};
+
+class TraceReader {
+public:
+  /**
+   * @brief Returns false if the data doesn't start with a trace header.
+   */
+  bool begin(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Decode the next event without consuming it. TRACE_NONE at the end
+   * of the trace (or at a truncated event).
+   */
+  const TraceEvent& peek();
+  TraceEvent next();
+
+  size_t offset() const { return cur.pos; }
+
+private:
+  // everything decoding depends on, so peek() can work on a copy
+  struct State {
+    size_t   pos;
+    uint32_t nowMs;
+    long     encoder;
+    uint16_t ntcRaw;
+    uint32_t tickDt;     // dt of the last TICK, for REPEAT
+    uint32_t repeatLeft; // TICKs still to hand out from a REPEAT
+  };
+
+  bool decode(TraceEvent& ev, State& st) const;
+  bool getVarint(size_t& p, uint32_t& v) const;
+  bool getSigned(size_t& p, int32_t& v) const;
+
+  const uint8_t* data = nullptr;
+  size_t   len = 0;
+  State    cur = {};
+
+  TraceEvent peeked;
+  State    peekState = {};
+  bool     havePeek = false;
+};
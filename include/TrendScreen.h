@@ -0,0 +1,34 @@
+#pragma once
+
+#include <U8g2lib.h>
+#include "TrendStore.h"
+
+// --- Trend Graph Screen ---
+// Plots one channel/tier of the TrendStore as a min/max envelope, one column
+// per bucket, newest on the right. After the first full draw the graph is only
+// scrolled: the framebuffer is shifted left one pixel per new bucket and the
+// new column is drawn, instead of re-plotting every point each frame.
+class TrendScreen {
+public:
+  /**
+   * @brief Draw the given channel/tier. Scrolls in any buckets closed since
+   * the last draw, or redraws fully if the view changed. Cheap to call every loop.
+   */
+  void update(U8G2& u8g2, const TrendStore& store, int channel, int tier);
+
+  /**
+   * @brief Force a full redraw on the next update() (e.g. after the menu used the buffer).
+   */
+  void invalidate() { valid = false; }
+
+private:
+  void redraw(U8G2& u8g2, const TrendStore& store);
+  void drawHeader(U8G2& u8g2, const TrendStore& store);
+  void drawColumn(U8G2& u8g2, const TrendStore& store, int x, int age);
+  void scrollLeft(U8G2& u8g2);
+
+  int channel = TREND_ENCLOSURE_TEMP;
+  int tier = 0;
+  uint32_t drawnCount = 0;
+  bool valid = false;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+// --- Trend History ---
+// Fixed-size, in-RAM history of the sensor readings at several resolutions.
+// Each tier keeps the last TREND_DEPTH buckets in a ring; a bucket holds the
+// min/max/avg of every sample that landed in its time slot. Values are stored
+// as tenths (int16) to keep the footprint small.
+//
+// append() is O(TREND_CHANNELS * TREND_TIERS): every tier accumulates into
+// its open bucket and closes it when the slot ends. A gap longer than one
+// slot (e.g. no readings for a while) closes a single bucket, it does not
+// back-fill the skipped slots.
+
+enum TrendChannel {
+  TREND_ENCLOSURE_TEMP = 0,
+  TREND_ENCLOSURE_HUMIDITY,
+  TREND_HEATER_TEMP,
+  TREND_CHANNELS
+};
+
+const int TREND_TIERS = 3;
+const int TREND_DEPTH = 120;          // buckets per tier, about one screen width
+const uint32_t TREND_TIER_MS[TREND_TIERS] = { 1000UL, 60UL * 1000UL, 10UL * 60UL * 1000UL };
+const char* const TREND_TIER_NAMES[TREND_TIERS] = { "1s", "1m", "10m" };
+const int TREND_RAM_BUDGET = 7 * 1024; // bytes, checked below
+
+struct TrendBucket {
+  int16_t minX10;
+  int16_t maxX10;
+  int16_t avgX10;
+};
+
+// marks a bucket that had no valid samples for a channel
+const int16_t TREND_EMPTY = INT16_MIN;
+
+class TrendStore {
+public:
+  /**
+   * @brief Add one reading per channel. Invalid readings (<= -99) are skipped
+   * for that channel only.
+   */
+  void append(uint32_t nowMs, const float values[TREND_CHANNELS]);
+
+  /**
+   * @brief Number of closed buckets ever produced by a tier. Grows by one each
+   * time a bucket closes, so the UI can tell how far to scroll.
+   */
+  uint32_t closedCount(int tier) const { return tiers[tier].closed; }
+
+  /**
+   * @brief Number of buckets currently held by a tier (up to TREND_DEPTH).
+   */
+  int size(int tier) const;
+
+  /**
+   * @brief Closed bucket by age, 0 is the newest. Returns false if there is no
+   * such bucket or the channel had no valid samples in it.
+   */
+  bool get(int tier, int channel, int age, TrendBucket& out) const;
+
+private:
+  struct Accumulator {
+    int32_t sum;
+    int16_t minX10;
+    int16_t maxX10;
+    uint16_t count;
+  };
+
+  struct Tier {
+    TrendBucket ring[TREND_DEPTH][TREND_CHANNELS];
+    Accumulator open[TREND_CHANNELS];
+    uint32_t    slotStartMs;
+    uint32_t    closed;
+    uint8_t     head;     // next ring slot to write
+    bool        started;
+  };
+
+  static void resetAccumulators(Accumulator* acc);
+  void closeBucket(Tier& t);
+
+  Tier tiers[TREND_TIERS] = {};
+};
+
+static_assert(sizeof(TrendStore) <= TREND_RAM_BUDGET, "TrendStore exceeds TREND_RAM_BUDGET");
@@ -0,0 +1,57 @@
+#include "AdaptiveSampler.h"
+
+#include <math.h>
+
+AdaptiveSampler::AdaptiveSampler(uint32_t minMs, uint32_t maxMs, float res)
+  : minIntervalMs(minMs), maxIntervalMs(maxMs), resolution(res), intervalMs(minMs) {}
+
+bool AdaptiveSampler::due(uint32_t nowMs) const {
+  if (!started) return true;
+  return nowMs - lastSampleMs >= intervalMs;
+}
+
+void AdaptiveSampler::kick() {
+  intervalMs = minIntervalMs;
+}
+
+void AdaptiveSampler::sampled(uint32_t nowMs, float value) {
+  samplesTaken++;
+
+  uint32_t elapsed = nowMs - lastSampleMs;
+  if (started) {
+    uint32_t slots = elapsed / minIntervalMs;
+    if (slots > 1) samplesSkipped += slots - 1;
+  }
+  lastSampleMs = nowMs;
+  started = true;
+
+  if (value <= -99.0) {
+    // failed read: retry soon once, then back off so a dead sensor isn't
+    // polled at the minimum interval forever
+    if (failedInRow < 16) failedInRow++;
+    uint32_t backoff = minIntervalMs << (failedInRow - 1);
+    intervalMs = backoff < maxIntervalMs ? backoff : maxIntervalMs;
+    return;
+  }
+  failedInRow = 0;
+
+  if (haveValue && elapsed > 0) {
+    float rate = fabsf(value - lastValue) * 1000.0 / elapsed;
+    ratePerS = 0.5 * ratePerS + 0.5 * rate;
+  }
+  lastValue = value;
+  haveValue = true;
+
+  // time for one resolution step at the current rate
+  uint32_t target = maxIntervalMs;
+  if (ratePerS > 0.0) {
+    float stepMs = resolution / ratePerS * 1000.0;
+    if (stepMs < (float)maxIntervalMs) target = (uint32_t)stepMs;
+  }
+  if (target < minIntervalMs) target = minIntervalMs;
+
+  // speed up immediately, back off gradually
+  if (target > intervalMs * 2) target = intervalMs * 2;
+  if (target > maxIntervalMs) target = maxIntervalMs;
+  intervalMs = target;
+}
@@ -0,0 +1,519 @@
+#include "Controller.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Hal.h"
+#include "ThermalProfile.h"
+#include "PredictiveHeater.h"
+#include "AdaptiveSampler.h"
+#include "SensorPipeline.h"
+
+// --- NTC Thermistor Configuration ---
+#define NTC_REFERENCE_RESISTANCE    4883  // Value of the series resistor in Ohms (e.g., 4.7kOhms or 10kOhms)
+#define NTC_NOMINAL_RESISTANCE      114400 // Nominal resistance of the thermistor at nominal temperature (e.g., 100kOhms for a 3950 NTC)
+#define NTC_NOMINAL_TEMPERATURE     25.7    // Nominal temperature for the thermistor in Celsius (e.g., 25 C)
+#define NTC_B_VALUE                 3950  // Beta coefficient (B-value) of the thermistor
+#define NTC_ESP32_ANALOG_RESOLUTION 4095  // ADC resolution for ESP32 (12-bit ADC, 0-4095)
+#define NTC_SAMPLES_PER_READ        9
+
+float targetTemperature = 0.0;
+int   targetFanSpeed = 50;
+float enclosureTempSHT30 = -99.9;
+float enclosureHumiditySHT30 = -99.9;
+float heaterTempNTC = -99.9;
+int minTemp = 0;
+int maxTemp = 50; //min and max enclosure temperature
+
+int selectedLine = 0;
+bool editingMode = false;
+bool heaterEnabled = false;
+bool relayState = false;
+
+// Pressing the heater line while heating turns it off. While off, a press
+// opens a choice of manual ON or one of the built-in profiles (knob), and the
+// next press starts it.
+int activeProfile = -1; // index into BUILTIN_PROFILES, -1 for manual target
+const int HEATER_CHOICE_ON = 0;                             // then 1..NUM_BUILTIN_PROFILES
+const int HEATER_CHOICE_CANCEL = NUM_BUILTIN_PROFILES + 1;  // leave it off
+const int NUM_HEATER_CHOICES = NUM_BUILTIN_PROFILES + 2;
+int heaterChoice = -1; // while picking on the heater line, -1 otherwise
+ProfileRunner profileRunner;
+PredictiveHeater predictiveHeater;
+
+// Pressing on "Current Temp" opens the trend graph, turning the knob cycles channel/resolution
+TrendStore trendStore;
+int trendChannel = TREND_ENCLOSURE_TEMP;
+int trendTier = 0;
+
+uint32_t lastTime;
+uint32_t lastSamplerReport;
+
+// Sensor polling adapts to how fast the readings move. The DHT library only
+// returns a fresh reading every 2 s, the NTC is just an ADC read.
+AdaptiveSampler ntcSampler(200, 5000, 0.2);   // min ms, max ms, resolution C
+AdaptiveSampler dhtSampler(2000, 15000, 1.0);  // DHT11 reports whole degrees
+
+// Readings are filtered per sensor before anything uses them (SensorPipeline.h).
+// Stale/failed thresholds sit a few sampler max intervals out.
+SensorChannel ntcChannel({ 15000, 30000, 1.0 });          // stale ms, failed ms, min outlier spread
+SensorChannel dhtTempChannel({ 45000, 120000, 2.0 });     // DHT11 is +-2 C
+SensorChannel dhtHumidityChannel({ 45000, 120000, 5.0 }); // and +-5 %RH
+
+// What the heater control uses once the enclosure sensor stops giving good readings
+enum EnclosureFallback {
+  FALLBACK_HOLD_LAST,    // keep using the last good reading
+  FALLBACK_NTC_ESTIMATE, // run the learned enclosure model forward from the NTC
+  FALLBACK_HEATER_OFF,   // hold through short dropouts, stop heating once the sensor has failed
+};
+EnclosureFallback enclosureFallback = FALLBACK_NTC_ESTIMATE;
+bool enclosureEstimated = false; // enclosureTempSHT30 currently comes from the fallback
+float enclosureEstimate = -99.9;
+uint32_t lastEstimateMs;
+
+// Input snapshot for the current pass. encoderValue mirrors what the encoder
+// will read after our own writes, so the pass never reads the hardware twice.
+static LoopInputs in;
+static long encoderValue;
+int lastEncoderPos;
+
+static DisplayModel display;
+static ControllerOutputs outputs;
+
+static void setEncoderValue(long value) {
+  halSetEncoderValue(value);
+  encoderValue = value;
+}
+
+static void setEncoderBounds(long minValue, long maxValue, bool circleValues) {
+  halSetEncoderBounds(minValue, maxValue, circleValues);
+  if (encoderValue < minValue) encoderValue = minValue;
+  if (encoderValue > maxValue) encoderValue = maxValue;
+}
+
+// logf() differs in the last bit between newlib and glibc, which would let a
+// replay on the host drift from the firmware. This only uses exact or basic
+// IEEE operations, so both give the same result.
+static float portableLogf(float x) {
+  int e;
+  float m = frexpf(x, &e); // x = m * 2^e, m in [0.5, 1)
+  if (m < 0.70710678f) {
+    m *= 2.0f;
+    e--;
+  }
+  float s = (m - 1.0f) / (m + 1.0f);
+  float s2 = s * s;
+  float series = s * (2.0f + s2 * (2.0f / 3 + s2 * (2.0f / 5 + s2 * (2.0f / 7 + s2 * (2.0f / 9)))));
+  return series + e * 0.69314718f;
+}
+
+// Same beta equation as the NTC_Thermistor library, from a raw ADC code
+static float ntcRawToCelsius(uint16_t raw) {
+  if (raw == 0 || raw >= NTC_ESP32_ANALOG_RESOLUTION) return NAN;
+  float resistance = (float)NTC_REFERENCE_RESISTANCE * raw / (NTC_ESP32_ANALOG_RESOLUTION - raw);
+  float inverseKelvin = 1.0f / (NTC_NOMINAL_TEMPERATURE + 273.15f)
+                      + portableLogf(resistance / NTC_NOMINAL_RESISTANCE) / NTC_B_VALUE;
+  return 1.0f / inverseKelvin - 273.15f;
+}
+
+static void heaterOff() {
+  heaterEnabled = false;
+  activeProfile = -1;
+  profileRunner.stop();
+}
+
+static const char* heaterChoiceName(int choice) {
+  if (choice == HEATER_CHOICE_ON) return "ON";
+  if (choice == HEATER_CHOICE_CANCEL) return "OFF";
+  return BUILTIN_PROFILES[choice - 1].name;
+}
+
+// Press on the heater line while picking: start what the knob is on
+static void applyHeaterChoice() {
+  if (heaterChoice == HEATER_CHOICE_ON) {
+    heaterEnabled = true;
+    halLog("editValues(1): heaterEnabled changed to -> true\n");
+  }
+  else if (heaterChoice != HEATER_CHOICE_CANCEL) {
+    activeProfile = heaterChoice - 1;
+    heaterEnabled = true;
+    // ramp from the enclosure temp, or from the manual target if there's no reading
+    float startTemp = enclosureTempSHT30 > -99.0 ? enclosureTempSHT30 : targetTemperature;
+    profileRunner.start(&BUILTIN_PROFILES[activeProfile], startTemp, in.nowMs);
+    halLog("editValues(1): started profile -> %s\n", BUILTIN_PROFILES[activeProfile].name);
+  }
+  heaterChoice = -1;
+}
+
+void editValues(int currentline){
+  switch (currentline) {
+    case 0:
+      if (encoderValue == lastEncoderPos){
+        break;
+      }
+      else {
+        int view = trendTier * TREND_CHANNELS + trendChannel + (encoderValue > lastEncoderPos ? 1 : -1);
+        int numViews = TREND_TIERS * TREND_CHANNELS;
+        view = (view + numViews) % numViews;
+        trendTier = view / TREND_CHANNELS;
+        trendChannel = view % TREND_CHANNELS;
+      }
+      setEncoderValue(0);
+      lastEncoderPos = encoderValue;
+      break;
+
+    case 1:
+      if (heaterChoice < 0) {
+        // first pass after the press
+        if (heaterEnabled) {
+          // one press from any heating state turns it off
+          heaterOff();
+          halLog("editValues(1): heaterEnabled changed to -> false\n");
+          editingMode = false; // one-shot action
+          halDelay(10);
+          setEncoderValue(1);
+          lastEncoderPos = encoderValue;
+          break;
+        }
+        // off: pick manual ON or a profile with the knob, press again to start it
+        heaterChoice = HEATER_CHOICE_ON;
+        lastEncoderPos = encoderValue;
+        break;
+      }
+      if (encoderValue == lastEncoderPos){
+        break;
+      }
+      heaterChoice = (heaterChoice + (encoderValue > lastEncoderPos ? 1 : -1) + NUM_HEATER_CHOICES) % NUM_HEATER_CHOICES;
+      setEncoderValue(0);
+      lastEncoderPos = encoderValue;
+      break;
+
+    case 2:
+      if (encoderValue == lastEncoderPos){
+        break;
+      }
+      else if (encoderValue > lastEncoderPos){
+        if (targetTemperature < maxTemp){
+          targetTemperature += 1;
+        }
+        else{
+          targetTemperature = maxTemp;
+        }
+      }
+      else if (targetTemperature > minTemp){
+        targetTemperature -= 1;
+      }
+      else{
+        targetTemperature =0;
+      }
+      setEncoderValue(0);
+      lastEncoderPos = encoderValue;
+      break;
+
+    case 3:
+      if (encoderValue == lastEncoderPos){
+        break;
+      }
+      else if (encoderValue > lastEncoderPos){
+        if (targetFanSpeed < 100){
+          targetFanSpeed += 5;
+        }
+        else{
+          targetFanSpeed = 100;
+        }
+      }
+      else if (targetFanSpeed > 0){
+        targetFanSpeed -= 5;
+      }
+      else{
+        targetFanSpeed=0;
+      }
+      setEncoderValue(0);
+      lastEncoderPos = encoderValue;
+      break;
+  }
+}
+
+void readNTCSensor() {
+  // median of the burst, so one noisy conversion can't drag the reading
+  uint16_t codes[NTC_SAMPLES_PER_READ];
+  for (int i=0; i<NTC_SAMPLES_PER_READ;i++){
+    codes[i] = halReadNtcRaw();
+  }
+  float celsius = ntcRawToCelsius(medianOf(codes, NTC_SAMPLES_PER_READ));
+  if (isnan(celsius)){
+    halLog("Failed to read temperature from NTC\n");
+  }
+  if (!ntcChannel.update(in.nowMs, celsius) && !isnan(celsius)){
+    halLog("NTC outlier rejected: %.1f\n", celsius);
+  }
+  ntcSampler.sampled(in.nowMs, isnan(celsius) ? -99.9 : celsius);
+}
+
+void readSHT30Sensor() { //modified for use with DHT11 instead of SHT30
+    float temp, humidity;
+    halReadDht(temp, humidity);
+
+    if (! isnan(temp)) {  // check if 'is not a number'
+      halLog("Temp *C = %.2f\t\t", temp);
+    } else {
+      halLog("Failed to read temperature\n");
+    }
+    if (!dhtTempChannel.update(in.nowMs, temp) && !isnan(temp)) {
+      halLog("Temp outlier rejected\t");
+    }
+
+    if (! isnan(humidity)) {  // check if 'is not a number'
+      halLog("Hum. %% = %.2f\n", humidity);
+    }
+    else {
+      halLog("Failed to read humidity\n");
+    }
+    dhtHumidityChannel.update(in.nowMs, humidity);
+
+    dhtSampler.sampled(in.nowMs, isnan(temp) ? -99.0 : temp);
+}
+
+// Turn the filtered channels into the values the rest of the controller uses,
+// applying the enclosure fallback when the DHT has dropped out.
+static void updateSensorValues() {
+  SensorHealth ntcHealth = ntcChannel.health(in.nowMs);
+  heaterTempNTC = (ntcHealth == SENSOR_OK || ntcHealth == SENSOR_STALE) ? ntcChannel.value() : -99.9;
+
+  SensorHealth humHealth = dhtHumidityChannel.health(in.nowMs);
+  enclosureHumiditySHT30 = (humHealth == SENSOR_OK || humHealth == SENSOR_STALE) ? dhtHumidityChannel.value() : -99.0;
+
+  float dtS = (in.nowMs - lastEstimateMs) / 1000.0;
+  lastEstimateMs = in.nowMs;
+
+  SensorHealth encHealth = dhtTempChannel.health(in.nowMs);
+  if (encHealth == SENSOR_OK) {
+    enclosureTempSHT30 = dhtTempChannel.value();
+    enclosureEstimate = enclosureTempSHT30;
+    enclosureEstimated = false;
+    return;
+  }
+
+  switch (enclosureFallback) {
+    case FALLBACK_HOLD_LAST:
+      enclosureTempSHT30 = encHealth == SENSOR_NO_DATA ? -99.0 : dhtTempChannel.value();
+      enclosureEstimated = false;
+      break;
+
+    case FALLBACK_NTC_ESTIMATE:
+      if (enclosureEstimate > -99.0 && heaterTempNTC > -99.0 && predictiveHeater.trained()) {
+        enclosureEstimate = predictiveHeater.stepEnclosure(enclosureEstimate, heaterTempNTC, dtS);
+        enclosureTempSHT30 = enclosureEstimate;
+        enclosureEstimated = true;
+      }
+      else {
+        // nothing to run the model with: same as FALLBACK_HEATER_OFF, a held
+        // value must never drive the relay past failedMs
+        enclosureEstimate = encHealth == SENSOR_STALE ? dhtTempChannel.value() : -99.9;
+        enclosureTempSHT30 = encHealth == SENSOR_STALE ? dhtTempChannel.value() : -99.0;
+        enclosureEstimated = false;
+      }
+      break;
+
+    case FALLBACK_HEATER_OFF:
+      enclosureTempSHT30 = encHealth == SENSOR_STALE ? dhtTempChannel.value() : -99.0;
+      enclosureEstimated = false;
+      break;
+  }
+}
+
+// The channel's value if its last read was good and recent, otherwise -99
+static float freshValue(const SensorChannel& channel) {
+  return channel.health(in.nowMs) == SENSOR_OK ? channel.value() : -99.0;
+}
+
+const char* const MENU_LABELS[NUM_MENU_ITEMS] = {
+  "Current Temp:",
+  "Heater",
+  "Target Temp:",
+  "Fan Speed:",
+  "Humidity:",
+  "Heater Core Temp:",
+};
+
+static void updateDisplay(float setpoint) {
+  display.selectedLine = selectedLine;
+  display.trendScreen = editingMode && selectedLine == 0;
+  display.trendChannel = trendChannel;
+  display.trendTier = trendTier;
+
+  for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
+    char* value = display.values[i];
+    switch (i) {
+      case 0:
+        snprintf(value, DISPLAY_VALUE_CHARS, "%s%.1f C", enclosureEstimated ? "~" : "", enclosureTempSHT30);
+        break;
+      case 1:
+        //Heater on off
+        if (heaterChoice >= 0){
+          snprintf(value, DISPLAY_VALUE_CHARS, "< %s >", heaterChoiceName(heaterChoice));
+        }
+        else if (activeProfile >= 0){
+          snprintf(value, DISPLAY_VALUE_CHARS, "%s %d/%d  %.1f C", BUILTIN_PROFILES[activeProfile].name,
+                   profileRunner.currentStep() + 1, BUILTIN_PROFILES[activeProfile].numSteps, setpoint);
+        }
+        else if (heaterEnabled){
+          snprintf(value, DISPLAY_VALUE_CHARS, "ON");
+        }
+        else{
+          snprintf(value, DISPLAY_VALUE_CHARS, "OFF");
+        }
+        break;
+      case 2:
+        snprintf(value, DISPLAY_VALUE_CHARS, "%.1f C", targetTemperature);
+        break;
+      case 3:
+        snprintf(value, DISPLAY_VALUE_CHARS, "%d %%", targetFanSpeed);
+        break;
+      case 4:
+        snprintf(value, DISPLAY_VALUE_CHARS, "%.2f %%", enclosureHumiditySHT30);
+        break;
+      case 5:
+        snprintf(value, DISPLAY_VALUE_CHARS, "%.1f C", heaterTempNTC);
+        break;
+    }
+  }
+}
+
+// FNV-1a, cheap enough to run every pass
+static uint32_t hashBytes(uint32_t h, const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= p[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+static uint32_t displayHash() {
+  uint32_t h = 2166136261UL;
+  int32_t header[4] = { display.selectedLine, display.trendScreen, display.trendChannel, display.trendTier };
+  h = hashBytes(h, header, sizeof(header));
+  if (display.trendScreen) {
+    // the graph is drawn from the store, so that's what the screen depends on
+    uint32_t closed = trendStore.closedCount(display.trendTier);
+    TrendBucket newest = { TREND_EMPTY, TREND_EMPTY, TREND_EMPTY };
+    trendStore.get(display.trendTier, display.trendChannel, 0, newest);
+    h = hashBytes(h, &closed, sizeof(closed));
+    h = hashBytes(h, &newest, sizeof(newest));
+  } else {
+    // the labels are constant, only the values can change what's on screen
+    for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
+      h = hashBytes(h, display.values[i], strlen(display.values[i]));
+    }
+  }
+  return h;
+}
+
+void controllerSetup() {
+  setEncoderBounds(0,3,false);
+}
+
+void controllerLoop() {
+  halReadLoopInputs(in);
+  encoderValue = in.encoderValue;
+
+  if (in.buttonPressed){
+    halLog("Pressed button\n");
+    setEncoderBounds(0,3,false);
+    lastEncoderPos = 0;
+
+    if (editingMode){
+      if (selectedLine == 1 && heaterChoice >= 0) applyHeaterChoice();
+      setEncoderBounds(0,3,true);
+      setEncoderValue(1);
+
+      editingMode = false;
+    }
+    else{
+      selectedLine = (int)encoderValue;
+      setEncoderBounds(-100,100,true);
+      setEncoderValue(0);
+      editingMode = true;
+    }
+  }
+
+  if (!editingMode){
+     selectedLine = (int)encoderValue;
+    }
+  else{
+      editValues(selectedLine);
+    }
+
+  float setpoint = targetTemperature;
+  if (activeProfile >= 0) {
+    setpoint = profileRunner.setpointAt(in.nowMs);
+    if (!profileRunner.active()) { // profile finished its last step
+      halLog("Profile finished\n");
+      activeProfile = -1;
+      heaterEnabled = false;
+    }
+  }
+
+  bool relayWasOn = relayState;
+  if (heaterEnabled && enclosureTempSHT30 > -99.0) {
+    relayState = predictiveHeater.decide(in.nowMs, setpoint, relayState, heaterTempNTC, enclosureTempSHT30);
+  }
+  else {
+    relayState = false;
+  }
+  if (relayState != relayWasOn) {
+    // a relay switch is when things start moving, watch closely
+    ntcSampler.kick();
+    dhtSampler.kick();
+  }
+  halSetRelay(relayState);
+
+  if (ntcSampler.due(in.nowMs)) {
+    readNTCSensor();
+  }
+  if (dhtSampler.due(in.nowMs)) {
+    readSHT30Sensor();
+  }
+  updateSensorValues();
+
+  if (in.nowMs - lastSamplerReport >= 60000){
+    halLog("Samples NTC: %lu taken, %lu skipped | DHT: %lu taken, %lu skipped\n",
+           (unsigned long)ntcSampler.taken(), (unsigned long)ntcSampler.skipped(),
+           (unsigned long)dhtSampler.taken(), (unsigned long)dhtSampler.skipped());
+    halLog("Sensors NTC: %s, %lu ms old, %lu rejected | DHT: %s, %lu ms old, %lu rejected, %lu failed%s\n",
+           sensorHealthName(ntcChannel.health(in.nowMs)), (unsigned long)ntcChannel.ageMs(in.nowMs),
+           (unsigned long)ntcChannel.rejected(),
+           sensorHealthName(dhtTempChannel.health(in.nowMs)), (unsigned long)dhtTempChannel.ageMs(in.nowMs),
+           (unsigned long)dhtTempChannel.rejected(), (unsigned long)dhtTempChannel.failedReads(),
+           enclosureEstimated ? ", using NTC estimate" : "");
+    lastSamplerReport = in.nowMs;
+  }
+
+  if (in.nowMs - lastTime > 200){ // bookkeeping on the latest readings, no sensor IO here
+    // only learn from and plot fresh readings, never a held or fallback value;
+    // a -99 also restarts the model's learning window
+    float measuredEnclosure = freshValue(dhtTempChannel);
+    float measuredHeater = freshValue(ntcChannel);
+    predictiveHeater.observe(in.nowMs, measuredHeater, measuredEnclosure, relayState);
+    float trendValues[TREND_CHANNELS] = { measuredEnclosure, freshValue(dhtHumidityChannel), measuredHeater };
+    trendStore.append(in.nowMs, trendValues);
+    lastTime = in.nowMs;
+  }
+
+  halSetFanDuty(targetFanSpeed);
+
+  updateDisplay(setpoint);
+  outputs.relay = relayState;
+  outputs.fanDuty = targetFanSpeed;
+  outputs.displayHash = displayHash();
+}
+
+const DisplayModel& controllerDisplay() {
+  return display;
+}
+
+const ControllerOutputs& controllerOutputs() {
+  return outputs;
+}
@@ -0,0 +1,55 @@
+#include "LabelCache.h"
+
+#include <string.h>
+
+static const int LABEL_GAP = 3; // min pixels between the end of a label and its value
+
+void LabelCache::begin(U8G2& u8g2, int lineHeight, int textX, const int* baselines) {
+  this->lineHeight = lineHeight < MAX_LINE_HEIGHT ? lineHeight : MAX_LINE_HEIGHT;
+  const uint8_t* buf = u8g2.getBufferPtr();
+  int rowBytes = u8g2.getBufferTileWidth();
+  int height = u8g2.getDisplayHeight();
+
+  for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
+    int top = i * this->lineHeight;
+    int bytes = (textX + u8g2.getStrWidth(MENU_LABELS[i]) + LABEL_GAP + 7) / 8;
+    labelBytes[i] = bytes < MAX_LABEL_BYTES ? bytes : MAX_LABEL_BYTES;
+    labelRows[i] = this->lineHeight + OVERHANG_ROWS;
+    if (top + labelRows[i] > height) labelRows[i] = height - top;
+
+    // render exactly what the old full-line pass drew, then keep the bytes
+    for (int selected = 0; selected < 2; ++selected) {
+      u8g2.clearBuffer();
+      if (selected) {
+        u8g2.setDrawColor(1);
+        u8g2.drawBox(0, top, u8g2.getDisplayWidth(), this->lineHeight);
+        u8g2.setDrawColor(0);
+      }
+      u8g2.drawStr(textX, baselines[i], MENU_LABELS[i]);
+      u8g2.setDrawColor(1);
+      for (int r = 0; r < labelRows[i]; ++r) {
+        memcpy(bitmaps[i][selected][r], buf + (top + r) * rowBytes, labelBytes[i]);
+      }
+    }
+  }
+  u8g2.clearBuffer();
+}
+
+void LabelCache::blit(U8G2& u8g2, int line, bool selected) const {
+  uint8_t* buf = u8g2.getBufferPtr();
+  int rowBytes = u8g2.getBufferTileWidth();
+  uint8_t* dst = buf + line * lineHeight * rowBytes;
+
+  if (selected) {
+    // the highlight covers the whole band, including anything the line above hung into it
+    for (int r = 0; r < lineHeight; ++r, dst += rowBytes) {
+      memcpy(dst, bitmaps[line][1][r], labelBytes[line]);
+    }
+    return;
+  }
+  // OR so the overhang rows merge with whatever is already in the next band
+  for (int r = 0; r < labelRows[line]; ++r, dst += rowBytes) {
+    const uint8_t* src = bitmaps[line][0][r];
+    for (int b = 0; b < labelBytes[line]; ++b) dst[b] |= src[b];
+  }
+}
@@ -0,0 +1,145 @@
+#include "PredictiveHeater.h"
+
+#include <math.h>
+
+static const float MAX_EULER_RATE_DT = 0.5;
+
+static float clampf(float v, float lo, float hi) {
+  if (v < lo) return lo;
+  if (v > hi) return hi;
+  return v;
+}
+
+PredictiveHeater::PredictiveHeater() {
+  // rough guesses for a small PTC heater in a printer-sized enclosure at ~22C
+  const float coreInit[2] = { 0.20, 0.010 };
+  const float encInit[3]  = { 0.002, 0.001, 0.022 };
+  core.reset(coreInit, 100.0);
+  enc.reset(encInit, 1.0);
+}
+
+void PredictiveHeater::observe(uint32_t nowMs, float H, float E, bool relayOn) {
+  if (H <= -99.0 || E <= -99.0) {
+    // sensor dropout, restart the learning window once readings come back
+    haveWindow = false;
+    return;
+  }
+  heaterC = H;
+  enclosureC = E;
+
+  if (!haveWindow) {
+    haveWindow = true;
+    windowStartMs = nowMs;
+    lastObserveMs = nowMs;
+    relayOnMs = 0;
+    windowH = H;
+    windowE = E;
+    lastRelay = relayOn;
+    return;
+  }
+
+  if (lastRelay) relayOnMs += nowMs - lastObserveMs;
+  lastObserveMs = nowMs;
+  lastRelay = relayOn;
+
+  uint32_t elapsed = nowMs - windowStartMs;
+  if (elapsed < LEARN_WINDOW_MS) return;
+
+  float dt = elapsed / 1000.0;
+  learn(dt, H - windowH, E - windowE, (float)relayOnMs / (float)elapsed);
+
+  windowStartMs = nowMs;
+  relayOnMs = 0;
+  windowH = H;
+  windowE = E;
+}
+
+void PredictiveHeater::learn(float dt, float dH, float dE, float duty) {
+  // regress on the window midpoint so slow sensors don't bias the estimate
+  float H = heaterC - dH / 2;
+  float E = enclosureC - dE / 2;
+  float diff = H - E;
+
+  float x[2] = { duty, -diff };
+  core.update(x, dH / dt, FORGET, 100.0);
+  float y[3] = { diff, -E, 1.0 };
+  enc.update(y, dE / dt, FORGET, 1.0);
+
+  clampModel();
+
+  if (trainedWindows < MIN_TRAINED_WINDOWS) trainedWindows++;
+}
+
+void PredictiveHeater::clampModel() {
+  // keep the model physical, a noisy DHT window can push it anywhere
+  core.theta[0] = clampf(core.theta[0], 0.001, 5.0);
+  core.theta[1] = clampf(core.theta[1], 0.0001, 1.0);
+  enc.theta[0]  = clampf(enc.theta[0], 0.00001, 0.5);
+  enc.theta[1]  = clampf(enc.theta[1], 0.00001, 0.5);
+  enc.theta[2]  = clampf(enc.theta[2], -1.0, 1.0);
+}
+
+void PredictiveHeater::setModel(float heatGain, float coreLoss, float coupling, float encLoss, float encBias) {
+  core.theta[0] = heatGain;
+  core.theta[1] = coreLoss;
+  enc.theta[0] = coupling;
+  enc.theta[1] = encLoss;
+  enc.theta[2] = encBias;
+  clampModel();
+  trainedWindows = MIN_TRAINED_WINDOWS;
+}
+
+// Forward Euler is only stable (and free of overshoot) while rate * dt stays
+// well below 1. A fast learned model gets split into more, shorter steps.
+static int eulerSubsteps(float rate, float dtS) {
+  float n = rate * dtS / MAX_EULER_RATE_DT;
+  return n > 1.0f ? (int)ceilf(n) : 1;
+}
+
+float PredictiveHeater::coastPeak(float H, float E, int startStep) const {
+  int substeps = eulerSubsteps(coreLoss() + coupling() + encLoss(), SIM_STEP_S);
+  float h = (float)SIM_STEP_S / substeps;
+  float peak = -99.9;
+  for (int i = 0; i <= SIM_STEPS; ++i) {
+    if (i >= startStep && E > peak) peak = E;
+    for (int k = 0; k < substeps; ++k) {
+      float diff = H - E;
+      float dH = -coreLoss() * diff;
+      float dE = coupling() * diff - encLoss() * E + encBias();
+      H += dH * h;
+      E += dE * h;
+    }
+  }
+  return peak;
+}
+
+float PredictiveHeater::stepEnclosure(float E, float H, float dtS) const {
+  int substeps = eulerSubsteps(coupling() + encLoss(), dtS);
+  float h = dtS / substeps;
+  for (int k = 0; k < substeps; ++k) {
+    E += (coupling() * (H - E) - encLoss() * E + encBias()) * h;
+  }
+  return E;
+}
+
+bool PredictiveHeater::decide(uint32_t nowMs, float setpointC, bool relayOn, float H, float E) {
+  if (E <= -99.0) return false;
+
+  bool want;
+  if (!trained() || H <= -99.0) {
+    want = E < setpointC;
+  } else if (relayOn) {
+    // cut once the heat already stored in the core is enough to reach the setpoint
+    want = coastPeak(H, E) < setpointC;
+  } else {
+    // start again when, after the core's lag, the enclosure would be below the band
+    want = coastPeak(H, E, LEAD_STEPS) < setpointC - HYSTERESIS_C;
+  }
+
+  if (want != relayOn) {
+    if (haveSwitched && nowMs - lastSwitchMs < MIN_SWITCH_MS) return relayOn;
+    haveSwitched = true;
+    lastSwitchMs = nowMs;
+  }
+  return want;
+}
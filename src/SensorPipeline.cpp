@@ -0,0 +1,108 @@
+#include "SensorPipeline.h"
+
+#include <math.h>
+
+// insertion sort, the arrays here are a handful of elements
+template <typename T>
+static T medianSorted(T* values, int n) {
+  for (int i = 1; i < n; ++i) {
+    T v = values[i];
+    int j = i - 1;
+    while (j >= 0 && values[j] > v) {
+      values[j + 1] = values[j];
+      j--;
+    }
+    values[j + 1] = v;
+  }
+  if (n % 2) return values[n / 2];
+  return (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+uint16_t medianOf(uint16_t* values, int n) {
+  return medianSorted(values, n);
+}
+
+float medianOf(float* values, int n) {
+  return medianSorted(values, n);
+}
+
+const char* sensorHealthName(SensorHealth health) {
+  switch (health) {
+    case SENSOR_OK:     return "ok";
+    case SENSOR_STALE:  return "stale";
+    case SENSOR_FAILED: return "failed";
+    default:            return "no data";
+  }
+}
+
+SensorChannel::SensorChannel(const SensorConfig& cfg) : config(cfg) {}
+
+void SensorChannel::accept(uint32_t nowMs, float value) {
+  history[historyHead] = value;
+  historyHead = (historyHead + 1) % WINDOW;
+  if (historyCount < WINDOW) historyCount++;
+  rejectCount = 0;
+
+  lastGood = value;
+  lastGoodMs = nowMs;
+  haveGood = true;
+}
+
+bool SensorChannel::update(uint32_t nowMs, float value) {
+  if (isnan(value)) {
+    failedCount++;
+    lastReadBad = true;
+    return false;
+  }
+
+  if (historyCount >= 3) {
+    float sorted[WINDOW];
+    for (int i = 0; i < historyCount; ++i) sorted[i] = history[i];
+    float median = medianOf(sorted, historyCount);
+    for (int i = 0; i < historyCount; ++i) sorted[i] = fabsf(history[i] - median);
+    float mad = medianOf(sorted, historyCount);
+
+    float threshold = HAMPEL_K * 1.4826f * mad;
+    if (threshold < config.minSpread) threshold = config.minSpread;
+
+    if (fabsf(value - median) > threshold) {
+      rejectedCount++;
+      lastReadBad = true;
+      // keep the latest run of rejected values
+      if (rejectCount == MAX_CONSECUTIVE_REJECTS) {
+        for (int i = 1; i < MAX_CONSECUTIVE_REJECTS; ++i) rejects[i - 1] = rejects[i];
+        rejectCount--;
+      }
+      rejects[rejectCount++] = value;
+      if (rejectCount < MAX_CONSECUTIVE_REJECTS) return false;
+
+      // A real change only if the rejected readings line up: a step (same
+      // level) or a ramp (same delta each sample) both have a near-zero second
+      // difference. Unrelated outliers in a row don't, and must not wipe the history.
+      for (int i = 2; i < rejectCount; ++i) {
+        float curvature = rejects[i] - 2 * rejects[i - 1] + rejects[i - 2];
+        if (fabsf(curvature) > threshold) return false;
+      }
+
+      // restart the history from the new level
+      historyCount = 0;
+      historyHead = 0;
+      for (int i = 0; i < rejectCount - 1; ++i) {
+        history[historyHead++] = rejects[i];
+        historyCount++;
+      }
+    }
+  }
+
+  lastReadBad = false;
+  accept(nowMs, value);
+  return true;
+}
+
+SensorHealth SensorChannel::health(uint32_t nowMs) const {
+  if (!haveGood) return SENSOR_NO_DATA;
+  uint32_t age = ageMs(nowMs);
+  if (age > config.failedMs) return SENSOR_FAILED;
+  if (lastReadBad || age > config.staleMs) return SENSOR_STALE;
+  return SENSOR_OK;
+}
@@ -0,0 +1,62 @@
+#include "ThermalProfile.h"
+
+#define MINUTES(m) ((uint32_t)(m) * 60UL * 1000UL)
+
+// Filament drying: warm up gently, soak, then bring it back down slowly so
+// the spool doesn't pick up moisture from condensation.
+static const ProfileStep DRY_STEPS[] = {
+  { 45.0, MINUTES(15), MINUTES(240) },
+  { 25.0, MINUTES(30), 0 },
+};
+
+// Resin post-cure: short ramp, shorter soak.
+static const ProfileStep CURE_STEPS[] = {
+  { 35.0, MINUTES(10), MINUTES(30) },
+  { 25.0, MINUTES(15), 0 },
+};
+
+const Profile BUILTIN_PROFILES[] = {
+  { "Dry",  DRY_STEPS,  sizeof(DRY_STEPS)  / sizeof(DRY_STEPS[0])  },
+  { "Cure", CURE_STEPS, sizeof(CURE_STEPS) / sizeof(CURE_STEPS[0]) },
+};
+const int NUM_BUILTIN_PROFILES = sizeof(BUILTIN_PROFILES) / sizeof(BUILTIN_PROFILES[0]);
+
+void ProfileRunner::start(const Profile* p, float startTempC, uint32_t nowMs) {
+  profile = p;
+  stepIndex = 0;
+  stepStartMs = nowMs;
+  stepFromC = startTempC;
+  lastSetpointC = startTempC;
+}
+
+void ProfileRunner::stop() {
+  profile = nullptr;
+}
+
+float ProfileRunner::setpointAt(uint32_t nowMs) {
+  if (!profile) return lastSetpointC;
+
+  while (stepIndex < profile->numSteps) {
+    const ProfileStep& step = profile->steps[stepIndex];
+    uint32_t elapsed = nowMs - stepStartMs;
+
+    if (elapsed < step.rampMs) {
+      float frac = (float)elapsed / (float)step.rampMs;
+      lastSetpointC = stepFromC + (step.setpointC - stepFromC) * frac;
+      return lastSetpointC;
+    }
+    if (elapsed < step.rampMs + step.holdMs) {
+      lastSetpointC = step.setpointC;
+      return lastSetpointC;
+    }
+
+    // step finished, the next one ramps from where this one ended
+    stepFromC = step.setpointC;
+    stepStartMs += step.rampMs + step.holdMs;
+    stepIndex++;
+  }
+
+  lastSetpointC = stepFromC;
+  stop();
+  return lastSetpointC;
+}
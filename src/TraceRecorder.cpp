@@ -0,0 +1,280 @@
+#include "TraceRecorder.h"
+
+#include <math.h>
+
+static const uint8_t TRACE_MAGIC[4] = { 'E', 'N', 'C', 'T' };
+// Bump whenever the format or what the OUT display hash covers changes, so an
+// old trace is rejected instead of showing up as a divergence.
+// 2: display hash covers the menu values only (labels are constant)
+// 3: REPEAT runs of idle TICKs
+static const uint8_t TRACE_VERSION = 3;
+static const size_t  MAX_EVENT_BYTES = 16;
+
+static const uint8_t TRACE_REPEAT = 5; // only in the encoding, read back as TICKs
+
+static const uint8_t FLAG_A = 0x08;
+static const uint8_t FLAG_B = 0x10;
+
+static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static int32_t dhtToX10(float v) { return (int32_t)lroundf(v * 10.0f); }
+
+float TraceWriter::quantizeDht(float value) {
+  if (isnan(value)) return value;
+  return dhtToX10(value) / 10.0f;
+}
+
+void TraceWriter::begin(Sink s, uint32_t max) {
+  sink = s;
+  maxBytes = max;
+  written = 0;
+  used = 0;
+  full = false;
+  lastNowMs = 0;
+  lastEncoder = 0;
+  lastNtc = 0;
+  lastTickDt = 0;
+  canRepeat = false;
+  pendingRepeats = 0;
+  haveOutputs = false;
+
+  eventStart = used;
+  for (int i = 0; i < 4; ++i) put(TRACE_MAGIC[i]);
+  put(TRACE_VERSION);
+  endEvent();
+}
+
+void TraceWriter::put(uint8_t b) {
+  buf[used++] = b;
+}
+
+void TraceWriter::putVarint(uint32_t v) {
+  while (v >= 0x80) {
+    put((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  put((uint8_t)v);
+}
+
+void TraceWriter::putSigned(int32_t v) {
+  putVarint(zigzag(v));
+}
+
+void TraceWriter::endEvent() {
+  if (written + used > maxBytes) {
+    // drop the event that didn't fit, the trace stays decodable up to here
+    used = eventStart;
+    full = true;
+    flush();
+    return;
+  }
+  if (used > sizeof(buf) - MAX_EVENT_BYTES) flush();
+  eventStart = used;
+}
+
+void TraceWriter::flushRepeats() {
+  if (pendingRepeats == 0 || full) return;
+  uint32_t n = pendingRepeats;
+  pendingRepeats = 0;
+  put(TRACE_REPEAT);
+  putVarint(n);
+  endEvent();
+}
+
+void TraceWriter::flush() {
+  flushRepeats();
+  if (used == 0) return;
+  size_t stored = sink ? sink(buf, used) : used;
+  // a short write leaves the last event cut off, the reader stops there
+  if (stored < used) full = true;
+  written += stored;
+  used = 0;
+  eventStart = 0;
+}
+
+void TraceWriter::tick(uint32_t nowMs, long encoder, bool button) {
+  if (full) return;
+  bool encChanged = encoder != lastEncoder;
+  uint32_t dt = nowMs - lastNowMs;
+  if (canRepeat && !encChanged && !button && dt == lastTickDt) {
+    pendingRepeats++;
+    lastNowMs = nowMs;
+    return;
+  }
+  flushRepeats();
+  if (full) return;
+  put(TRACE_TICK | (encChanged ? FLAG_A : 0) | (button ? FLAG_B : 0));
+  putVarint(dt);
+  if (encChanged) putSigned((int32_t)(encoder - lastEncoder));
+  endEvent();
+  if (full) return;
+  lastNowMs = nowMs;
+  lastEncoder = encoder;
+  lastTickDt = dt;
+  canRepeat = true;
+}
+
+void TraceWriter::ntc(uint16_t raw) {
+  if (full) return;
+  flushRepeats(); // keep the order, the run can go on after this event
+  if (full) return;
+  put(TRACE_NTC);
+  putSigned((int32_t)raw - (int32_t)lastNtc);
+  endEvent();
+  if (full) return;
+  lastNtc = raw;
+}
+
+void TraceWriter::dht(float tempC, float humidity) {
+  if (full) return;
+  bool tValid = !isnan(tempC);
+  bool hValid = !isnan(humidity);
+  flushRepeats(); // keep the order, the run can go on after this event
+  if (full) return;
+  put(TRACE_DHT | (tValid ? FLAG_A : 0) | (hValid ? FLAG_B : 0));
+  if (tValid) putSigned(dhtToX10(tempC));
+  if (hValid) putSigned(dhtToX10(humidity));
+  endEvent();
+}
+
+void TraceWriter::outputs(bool relay, int fanDuty, uint32_t displayHash) {
+  if (full) return;
+  if (haveOutputs && relay == lastRelay && fanDuty == lastFan && displayHash == lastHash) return;
+  flushRepeats(); // keep the order, the run can go on after this event
+  if (full) return;
+  put(TRACE_OUT | (relay ? FLAG_A : 0));
+  putVarint((uint32_t)fanDuty);
+  for (int i = 0; i < 4; ++i) put((uint8_t)(displayHash >> (8 * i)));
+  endEvent();
+  if (full) return;
+  haveOutputs = true;
+  lastRelay = relay;
+  lastFan = fanDuty;
+  lastHash = displayHash;
+}
+
+bool TraceReader::begin(const uint8_t* d, size_t n) {
+  data = d;
+  len = n;
+  cur = {};
+  havePeek = false;
+  if (len < 5) return false;
+  for (int i = 0; i < 4; ++i) {
+    if (data[i] != TRACE_MAGIC[i]) return false;
+  }
+  if (data[4] != TRACE_VERSION) return false;
+  cur.pos = 5;
+  return true;
+}
+
+bool TraceReader::getVarint(size_t& p, uint32_t& v) const {
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (p >= len) return false;
+    uint8_t b = data[p++];
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+bool TraceReader::getSigned(size_t& p, int32_t& v) const {
+  uint32_t u;
+  if (!getVarint(p, u)) return false;
+  v = unzigzag(u);
+  return true;
+}
+
+static void idleTick(TraceEvent& ev, uint32_t nowMs, long encoder) {
+  ev.type = TRACE_TICK;
+  ev.nowMs = nowMs;
+  ev.encoder = encoder;
+  ev.button = false;
+}
+
+bool TraceReader::decode(TraceEvent& ev, State& st) const {
+  ev.type = TRACE_NONE;
+  if (st.repeatLeft > 0) {
+    st.repeatLeft--;
+    st.nowMs += st.tickDt;
+    idleTick(ev, st.nowMs, st.encoder);
+    return true;
+  }
+  if (st.pos >= len) return false;
+  size_t& p = st.pos;
+  uint8_t hdr = data[p++];
+  uint32_t u;
+  int32_t s;
+
+  switch (hdr & 0x07) {
+    case TRACE_TICK:
+      if (!getVarint(p, u)) return false;
+      st.nowMs += u;
+      st.tickDt = u;
+      if (hdr & FLAG_A) {
+        if (!getSigned(p, s)) return false;
+        st.encoder += s;
+      }
+      ev.nowMs = st.nowMs;
+      ev.encoder = st.encoder;
+      ev.button = (hdr & FLAG_B) != 0;
+      break;
+
+    case TRACE_REPEAT:
+      if (!getVarint(p, u) || u == 0) return false;
+      st.repeatLeft = u - 1;
+      st.nowMs += st.tickDt;
+      idleTick(ev, st.nowMs, st.encoder);
+      return true;
+
+    case TRACE_NTC:
+      if (!getSigned(p, s)) return false;
+      st.ntcRaw = (uint16_t)(st.ntcRaw + s);
+      ev.ntcRaw = st.ntcRaw;
+      break;
+
+    case TRACE_DHT:
+      ev.tempC = NAN;
+      ev.humidity = NAN;
+      if (hdr & FLAG_A) {
+        if (!getSigned(p, s)) return false;
+        ev.tempC = s / 10.0f;
+      }
+      if (hdr & FLAG_B) {
+        if (!getSigned(p, s)) return false;
+        ev.humidity = s / 10.0f;
+      }
+      break;
+
+    case TRACE_OUT:
+      if (!getVarint(p, u)) return false;
+      ev.relay = (hdr & FLAG_A) != 0;
+      ev.fanDuty = (int)u;
+      if (p + 4 > len) return false;
+      ev.displayHash = 0;
+      for (int i = 0; i < 4; ++i) ev.displayHash |= (uint32_t)data[p++] << (8 * i);
+      break;
+
+    default:
+      return false;
+  }
+  ev.type = hdr & 0x07;
+  return true;
+}
+
+const TraceEvent& TraceReader::peek() {
+  if (!havePeek) {
+    peekState = cur;
+    if (!decode(peeked, peekState)) peeked.type = TRACE_NONE;
+    havePeek = true;
+  }
+  return peeked;
+}
+
+TraceEvent TraceReader::next() {
+  TraceEvent ev = peek();
+  if (ev.type != TRACE_NONE) cur = peekState;
+  havePeek = false;
+  return ev;
+}
@@ -0,0 +1,110 @@
+#include "TrendScreen.h"
+
+static const int HEADER_HEIGHT = 10;
+static const int GRAPH_TOP = HEADER_HEIGHT + 1;
+static const int GRAPH_X = 8;                 // byte aligned, leaves room for the axis ticks
+static const int GRAPH_HEIGHT = 64 - GRAPH_TOP;
+
+static const char* const CHANNEL_NAMES[TREND_CHANNELS] = { "Encl Temp", "Humidity", "Heater Core" };
+static const char* const CHANNEL_UNITS[TREND_CHANNELS] = { "C", "%", "C" };
+// Fixed y-ranges (tenths). A fixed scale is what lets the graph scroll
+// without re-plotting the old columns.
+static const int16_t CHANNEL_MIN_X10[TREND_CHANNELS] = { 0, 0, 0 };
+static const int16_t CHANNEL_MAX_X10[TREND_CHANNELS] = { 600, 1000, 1200 };
+
+static int valueToY(int channel, int16_t x10) {
+  int32_t span = CHANNEL_MAX_X10[channel] - CHANNEL_MIN_X10[channel];
+  int32_t v = x10 - CHANNEL_MIN_X10[channel];
+  if (v < 0) v = 0;
+  if (v > span) v = span;
+  return 63 - (int)(v * (GRAPH_HEIGHT - 1) / span);
+}
+
+void TrendScreen::drawHeader(U8G2& u8g2, const TrendStore& store) {
+  char buf[32];
+  TrendBucket b;
+  u8g2.setDrawColor(0);
+  u8g2.drawBox(0, 0, u8g2.getDisplayWidth(), HEADER_HEIGHT);
+  u8g2.setDrawColor(1);
+  if (store.get(tier, channel, 0, b)) {
+    snprintf(buf, sizeof(buf), "%s %s  %.1f %s", CHANNEL_NAMES[channel], TREND_TIER_NAMES[tier],
+             b.avgX10 / 10.0, CHANNEL_UNITS[channel]);
+  } else {
+    snprintf(buf, sizeof(buf), "%s %s  --.-", CHANNEL_NAMES[channel], TREND_TIER_NAMES[tier]);
+  }
+  u8g2.setCursor(2, HEADER_HEIGHT - 2);
+  u8g2.print(buf);
+}
+
+void TrendScreen::drawColumn(U8G2& u8g2, const TrendStore& store, int x, int age) {
+  TrendBucket b;
+  if (!store.get(tier, channel, age, b)) return;
+  int yTop = valueToY(channel, b.maxX10);
+  int yBottom = valueToY(channel, b.minX10);
+  u8g2.drawVLine(x, yTop, yBottom - yTop + 1);
+}
+
+void TrendScreen::scrollLeft(U8G2& u8g2) {
+  // The ST7920 full buffer is row major, getBufferTileWidth() bytes per
+  // pixel row, leftmost pixel in the MSB. Shift the graph area left by one
+  // pixel; the rightmost column comes out blank for the new bucket.
+  uint8_t* buf = u8g2.getBufferPtr();
+  int rowBytes = u8g2.getBufferTileWidth();
+  for (int y = GRAPH_TOP; y < 64; ++y) {
+    uint8_t* row = buf + y * rowBytes;
+    for (int i = GRAPH_X / 8; i < rowBytes - 1; ++i) {
+      row[i] = (row[i] << 1) | (row[i + 1] >> 7);
+    }
+    row[rowBytes - 1] <<= 1;
+  }
+}
+
+void TrendScreen::redraw(U8G2& u8g2, const TrendStore& store) {
+  u8g2.clearBuffer();
+  drawHeader(u8g2, store);
+
+  // axis ticks at 0, 1/2 and full scale
+  u8g2.drawVLine(GRAPH_X - 2, GRAPH_TOP, GRAPH_HEIGHT);
+  u8g2.drawHLine(GRAPH_X - 5, GRAPH_TOP, 3);
+  u8g2.drawHLine(GRAPH_X - 5, GRAPH_TOP + GRAPH_HEIGHT / 2, 3);
+  u8g2.drawHLine(GRAPH_X - 5, 63, 3);
+
+  int n = store.size(tier);
+  int right = u8g2.getDisplayWidth() - 1;
+  for (int age = 0; age < n && right - age >= GRAPH_X; ++age) {
+    drawColumn(u8g2, store, right - age, age);
+  }
+
+  drawnCount = store.closedCount(tier);
+  valid = true;
+  u8g2.sendBuffer();
+}
+
+void TrendScreen::update(U8G2& u8g2, const TrendStore& store, int newChannel, int newTier) {
+  if (newChannel != channel || newTier != tier) {
+    channel = newChannel;
+    tier = newTier;
+    valid = false;
+  }
+  if (!valid) {
+    redraw(u8g2, store);
+    return;
+  }
+
+  uint32_t newBuckets = store.closedCount(tier) - drawnCount;
+  if (newBuckets == 0) return;
+  if (newBuckets >= (uint32_t)TREND_DEPTH) {
+    redraw(u8g2, store);
+    return;
+  }
+
+  int right = u8g2.getDisplayWidth() - 1;
+  for (int age = (int)newBuckets - 1; age >= 0; --age) {
+    scrollLeft(u8g2);
+    drawColumn(u8g2, store, right, age);
+  }
+  drawHeader(u8g2, store);
+
+  drawnCount = store.closedCount(tier);
+  u8g2.sendBuffer();
+}
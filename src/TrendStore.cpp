@@ -0,0 +1,72 @@
+#include "TrendStore.h"
+
+void TrendStore::resetAccumulators(Accumulator* acc) {
+  for (int c = 0; c < TREND_CHANNELS; ++c) {
+    acc[c].sum = 0;
+    acc[c].minX10 = INT16_MAX;
+    acc[c].maxX10 = INT16_MIN;
+    acc[c].count = 0;
+  }
+}
+
+void TrendStore::closeBucket(Tier& t) {
+  for (int c = 0; c < TREND_CHANNELS; ++c) {
+    const Accumulator& a = t.open[c];
+    TrendBucket& b = t.ring[t.head][c];
+    if (a.count == 0) {
+      b.minX10 = b.maxX10 = b.avgX10 = TREND_EMPTY;
+    } else {
+      b.minX10 = a.minX10;
+      b.maxX10 = a.maxX10;
+      b.avgX10 = (int16_t)(a.sum / a.count);
+    }
+  }
+  t.head = (t.head + 1) % TREND_DEPTH;
+  t.closed++;
+  resetAccumulators(t.open);
+}
+
+void TrendStore::append(uint32_t nowMs, const float values[TREND_CHANNELS]) {
+  int16_t x10[TREND_CHANNELS];
+  bool valid[TREND_CHANNELS];
+  for (int c = 0; c < TREND_CHANNELS; ++c) {
+    valid[c] = values[c] > -99.0 && values[c] < 3000.0;
+    x10[c] = valid[c] ? (int16_t)(values[c] * 10.0 + (values[c] < 0 ? -0.5 : 0.5)) : 0;
+  }
+
+  for (int i = 0; i < TREND_TIERS; ++i) {
+    Tier& t = tiers[i];
+    if (!t.started) {
+      t.started = true;
+      t.slotStartMs = nowMs;
+      resetAccumulators(t.open);
+    } else if (nowMs - t.slotStartMs >= TREND_TIER_MS[i]) {
+      closeBucket(t);
+      // stay aligned to the slot grid unless we fell more than a slot behind
+      t.slotStartMs += TREND_TIER_MS[i];
+      if (nowMs - t.slotStartMs >= TREND_TIER_MS[i]) t.slotStartMs = nowMs;
+    }
+
+    for (int c = 0; c < TREND_CHANNELS; ++c) {
+      if (!valid[c]) continue;
+      Accumulator& a = t.open[c];
+      a.sum += x10[c];
+      if (x10[c] < a.minX10) a.minX10 = x10[c];
+      if (x10[c] > a.maxX10) a.maxX10 = x10[c];
+      if (a.count < UINT16_MAX) a.count++;
+    }
+  }
+}
+
+int TrendStore::size(int tier) const {
+  uint32_t closed = tiers[tier].closed;
+  return closed < (uint32_t)TREND_DEPTH ? (int)closed : TREND_DEPTH;
+}
+
+bool TrendStore::get(int tier, int channel, int age, TrendBucket& out) const {
+  if (age < 0 || age >= size(tier)) return false;
+  const Tier& t = tiers[tier];
+  int idx = (t.head + TREND_DEPTH - 1 - age) % TREND_DEPTH;
+  out = t.ring[idx][channel];
+  return out.avgX10 != TREND_EMPTY;
+}
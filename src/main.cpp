@@ -9,7 +9,14 @@
 #include <Adafruit_Sensor.h>
 #include <DHT.h>
 #include <DHT_U.h>
-#include <NTC_Thermistor.h> // For the NTC thermistor
+#include <LittleFS.h>
+#include <stdarg.h>
+
+#include "Hal.h"
+#include "Controller.h"
+#include "TrendScreen.h"
+#include "LabelCache.h"
+#include "TraceRecorder.h"
 
 // --- Pin Definitions ---
 // Display
@@ -29,27 +36,13 @@ RotaryEncoder rotaryEncoder(ENCODER_A_PIN, ENCODER_B_PIN, 50, ENCODER_STEPS_PER_
 const int NTC_SENSOR_PIN = 34;
 const int RelayPin = 32;
 
-// --- NTC Thermistor Configuration ---
-#define NTC_REFERENCE_RESISTANCE    4883  // Value of the series resistor in Ohms (e.g., 4.7kOhms or 10kOhms)
-#define NTC_NOMINAL_RESISTANCE      114400 // Nominal resistance of the thermistor at nominal temperature (e.g., 100kOhms for a 3950 NTC)
-#define NTC_NOMINAL_TEMPERATURE     25.7    // Nominal temperature for the thermistor in Celsius (e.g., 25 C)
-#define NTC_B_VALUE                 3950  // Beta coefficient (B-value) of the thermistor
-#define NTC_ESP32_ANALOG_RESOLUTION 4095  // ADC resolution for ESP32 (12-bit ADC, 0-4095)
-#define NTC_ESP32_ADC_VREF_MV       3280  // ADC reference voltage in millivolts (e.g., 3300mV for 3.3V)
-
-float targetTemperature = 0.0;
-int   targetFanSpeed = 50;
-float enclosureTempSHT30 = -99.9;
-float enclosureHumiditySHT30 = -99.9;
-float heaterTempNTC = -99.9;
-int minTemp = 0;
-int maxTemp = 50; //min and max enclosure temperature
+// NTC conversion (resistor values, beta) lives in Controller.cpp, this side only reads raw ADC codes
+
 int DHTPIN = 4;
 #define DHTTYPE    DHT11     // DHT 11
 // --- Sensor Objects ---
 // Adafruit_SHT31 sht31 = Adafruit_SHT31(); //will use in final build, 
 DHT_Unified dht(DHTPIN, DHTTYPE);
-Thermistor* ntc_thermistor; // Pointer for the NTC thermistor object
 
 
 
@@ -72,32 +65,35 @@ U8G2_ST7920_128X64_F_SW_SPI u8g2(U8G2_R0, 18, 23, 5, DISPLAY_RST_PIN);
 
 
 
-// Buffer for formatting strings to display
-char displayBuffer[32];
-
-
-const int NUM_MENU_ITEMS = 6;
 const int LINE_HEIGHT = 10;
 const int DISPLAY_WIDTH = 128;
 const int TEXT_X_OFFSET = 2;
 int text_Y_baselines[NUM_MENU_ITEMS];
 
-int selectedLine = 0;
-bool editingMode = false;
-int editingLine = -1;
-long encoderValueAtEditStart = 0;
-float initialValueForEditingFloat = 0.0;
-int initialValueForEditingInt = 0;
-
 bool turnedRightFlag = false;
 bool turnedLeftFlag = false;
-bool buttonPressedFlag = false;
-bool buttonWasPressedThisLoop = false;
-bool heaterEnabled = false;
-
-long lastTime;
-
-int lastEncoderPos;
+volatile bool buttonPressedFlag = false;
+
+TrendScreen trendScreen;
+LabelCache labelCache;
+
+// --- Input Trace ---
+// Every input the controller sees is recorded to flash so field problems can
+// be replayed on the host (see tools/replay). The previous boot's trace is kept
+// as TRACE_PREV_PATH. Send 'd' (current) or 'p' (previous) over serial for a hex dump.
+#define TRACE_PATH       "/trace.bin"
+#define TRACE_PREV_PATH  "/trace_prev.bin"
+const uint32_t TRACE_MAX_BYTES = 1024UL * 1024UL;
+const uint32_t TRACE_FS_RESERVE = 16UL * 1024UL; // LittleFS metadata blocks, never fill the partition
+const uint32_t TRACE_FLUSH_MS = 10000;          // commit to flash at most this often
+const uint32_t MIN_PASS_MS = 50;                // steady loop rate: bounds the trace rate, and idle
+                                                // passes with equal dt compress to nothing (REPEAT)
+
+TraceWriter traceWriter;
+File traceFile;
+uint32_t lastTraceFlushMs;
+uint32_t lastPassMs;
+bool traceFullReported;
 
 void turnedRight()
 {
@@ -138,132 +134,239 @@ void buttonCallback()
 {
   detachInterrupt(ENCODER_SW_PIN);
 	// Serial.printf( "boop! button was down for %lu ms\n", duration );
-  if (buttonPressedFlag){
+  buttonPressedFlag = true; // the loop handles it (and re-arms) on its next pass
+}
+
+// --- Hal.h on the ESP32 ---
+// Inputs go through the trace writer on their way to the controller.
+
+void halReadLoopInputs(LoopInputs& in) {
+  in.buttonPressed = buttonPressedFlag;
+  if (in.buttonPressed) {
+    delay(300);
+    attachInterrupt(ENCODER_SW_PIN, buttonCallback,  FALLING);
     buttonPressedFlag = false;
   }
-  else{
-    buttonPressedFlag = true;
+  in.nowMs = millis();
+  in.encoderValue = rotaryEncoder.getEncoderValue();
+  traceWriter.tick(in.nowMs, in.encoderValue, in.buttonPressed);
+}
+
+uint16_t halReadNtcRaw() {
+  uint16_t raw = analogRead(NTC_SENSOR_PIN);
+  traceWriter.ntc(raw);
+  return raw;
+}
+
+void halReadDht(float& tempC, float& humidity) { //modified for use with DHT11 instead of SHT30
+  sensors_event_t event;
+  dht.temperature().getEvent(&event);
+  tempC = TraceWriter::quantizeDht(event.temperature);
+  dht.humidity().getEvent(&event);
+  humidity = TraceWriter::quantizeDht(event.relative_humidity);
+  traceWriter.dht(tempC, humidity);
+}
+
+void halSetRelay(bool on) {
+  digitalWrite(RelayPin, on ? HIGH : LOW);
+}
+
+void halSetFanDuty(int percent) {
+  fan.setDutyCycle(percent);
+}
+
+void halSetEncoderBounds(long minValue, long maxValue, bool circleValues) {
+  rotaryEncoder.setBoundaries(minValue, maxValue, circleValues);
+}
+
+void halSetEncoderValue(long value) {
+  rotaryEncoder.setEncoderValue(value);
+}
+
+void halDelay(uint32_t ms) {
+  delay(ms);
+}
+
+void halLog(const char* fmt, ...) {
+  char buf[128];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  Serial.print(buf);
+}
+
+size_t traceSink(const uint8_t* data, size_t len) {
+  if (!traceFile) return 0;
+  return traceFile.write(data, len); // short once the partition is full
+}
+
+// What the partition has left, keeping TRACE_FS_RESERVE free
+uint32_t traceBudget() {
+  size_t total = LittleFS.totalBytes();
+  size_t used = LittleFS.usedBytes();
+  return total > used + TRACE_FS_RESERVE ? total - used - TRACE_FS_RESERVE : 0;
+}
+
+void beginTrace() {
+  if (!LittleFS.begin(true)) {
+    Serial.println("LittleFS mount failed, not recording a trace");
+    return;
+  }
+  if (LittleFS.exists(TRACE_PATH)) {
+    LittleFS.remove(TRACE_PREV_PATH);
+    LittleFS.rename(TRACE_PATH, TRACE_PREV_PATH);
   }
-  rotaryEncoder.setBoundaries(1,3,false);
-  // rotaryEncoder.setEncoderValue(1);//i think this is a good implementation - i disagree
-  lastEncoderPos = 0;
-  
+  traceFile = LittleFS.open(TRACE_PATH, "w");
+
+  // The current trace has priority: if keeping the previous one would leave
+  // less than TRACE_MAX_BYTES, drop it.
+  uint32_t budget = traceBudget();
+  if (budget < TRACE_MAX_BYTES && LittleFS.exists(TRACE_PREV_PATH)) {
+    LittleFS.remove(TRACE_PREV_PATH);
+    Serial.println("Dropped the previous trace to make room");
+    budget = traceBudget();
+  }
+  if (budget > TRACE_MAX_BYTES) budget = TRACE_MAX_BYTES;
+  Serial.printf("Trace budget %lu bytes\n", (unsigned long)budget);
+  traceWriter.begin(traceSink, budget);
+  traceFullReported = false;
 }
 
-void editValues(int currentline){
-  switch (currentline) {
-    case 1:
-      editingMode = false;
-      Serial.print("editValues(1) called. Current heaterEnabled before toggle: ");
-      Serial.println(heaterEnabled ? "true" : "false");
-
-      editingMode = false; // This is good, makes it a one-shot action
-      if (heaterEnabled) {
-          heaterEnabled = false;
-          Serial.println("editValues(1): heaterEnabled changed to -> false");
-      } else {
-          heaterEnabled = true;
-          Serial.println("editValues(1): heaterEnabled changed to -> true");
-      }
-      
-      // editingMode = false;
-      delay(10);
-      rotaryEncoder.setEncoderValue(1);
-      lastEncoderPos = rotaryEncoder.getEncoderValue();
-      break;
+// Report once when the trace stops recording, it doesn't restart until reboot
+void checkTraceFull() {
+  if (traceFullReported || !traceWriter.truncated()) return;
+  Serial.printf("Trace full at %lu bytes, recording stopped until reboot\n", (unsigned long)traceWriter.bytesWritten());
+  traceFullReported = true;
+}
 
-    case 2:
-      if (rotaryEncoder.getEncoderValue() == lastEncoderPos){
-        break;
-      }
-      else if (rotaryEncoder.getEncoderValue() > lastEncoderPos){
-        if (targetTemperature < maxTemp){
-          targetTemperature += 1;
-          
-        }
-        else{
-          targetTemperature = maxTemp;
-        }
-      }
-      else if (targetTemperature > minTemp){
-        targetTemperature -= 1;
+void flushTrace() {
+  traceWriter.flush();
+  if (traceFile) traceFile.flush();
+  lastTraceFlushMs = millis();
+}
 
-      }
-      else{
-        targetTemperature =0;
-      }
-      rotaryEncoder.setEncoderValue(0);
-      lastEncoderPos = rotaryEncoder.getEncoderValue();
+// The dump goes out one line at a time, only as fast as the serial TX buffer
+// drains, so controllerLoop() keeps running (and the heater stays controlled)
+// for the minutes a full trace takes at 115200 baud.
+const size_t TRACE_DUMP_LINE = 32; // bytes per hex line
+
+File dumpFile;
+uint32_t dumpLeft; // size at the start, the current trace keeps growing meanwhile
+
+void startDump(const char* path) {
+  if (dumpFile) {
+    Serial.println("Dump already running");
+    return;
+  }
+  flushTrace();
+  dumpFile = LittleFS.open(path, "r");
+  if (!dumpFile) {
+    Serial.println("No trace");
+    return;
+  }
+  dumpLeft = dumpFile.size();
+  Serial.printf("TRACE BEGIN %s %lu\n", path, (unsigned long)dumpLeft);
+}
+
+void continueDump() {
+  if (!dumpFile) return;
+  while (dumpLeft > 0 && Serial.availableForWrite() >= (int)(2 * TRACE_DUMP_LINE + 2)) {
+    uint8_t chunk[TRACE_DUMP_LINE];
+    size_t n = dumpFile.read(chunk, dumpLeft < sizeof(chunk) ? dumpLeft : sizeof(chunk));
+    if (n == 0) {
+      dumpLeft = 0;
       break;
-    case 3:
-      if (rotaryEncoder.getEncoderValue() == lastEncoderPos){
-        break;
-      }
-      else if (rotaryEncoder.getEncoderValue() > lastEncoderPos){
-        if (targetFanSpeed < 100){
-          targetFanSpeed += 5;
-        }
-        else{
-          targetFanSpeed = 100;
-        }
-      }
-      else if (targetFanSpeed > 0){
-        targetFanSpeed -= 5;
+    }
+    char line[2 * TRACE_DUMP_LINE + 1];
+    for (size_t i = 0; i < n; ++i) snprintf(line + 2 * i, 3, "%02x", chunk[i]);
+    Serial.println(line);
+    dumpLeft -= n;
+  }
+  if (dumpLeft == 0) {
+    Serial.println("TRACE END");
+    dumpFile.close();
+  }
+}
 
+void renderMenu(const DisplayModel& model) {
+  u8g2.clearBuffer();
+  for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
+      bool selected = i == model.selectedLine;
+      int valueX = labelCache.valueX(i);
+
+      labelCache.blit(u8g2, i, selected); // label bitmap, no glyph rendering
+      if (selected) {
+          u8g2.setDrawColor(1);
+          u8g2.drawBox(valueX, i * LINE_HEIGHT, DISPLAY_WIDTH - valueX, LINE_HEIGHT);
+          u8g2.setDrawColor(0);
       }
-      else{
-        targetFanSpeed=0;
-      }
-      rotaryEncoder.setEncoderValue(0);
-      lastEncoderPos = rotaryEncoder.getEncoderValue();
-      break;
-      
-      
+      u8g2.drawStr(valueX, text_Y_baselines[i], model.values[i]);
+      u8g2.setDrawColor(1);
   }
-  
 }
 
-void readNTCSensor() {
-  float heaterTemps[10];
-  heaterTempNTC = 0;
-  for (int i=0; i<9;i++){
-   
-    heaterTempNTC += ntc_thermistor->readCelsius();
+void renderDisplay(const DisplayModel& model) {
+  if (model.trendScreen) {
+    trendScreen.update(u8g2, trendStore, model.trendChannel, model.trendTier); // only scrolls in new buckets
+    return;
   }
-  heaterTempNTC = heaterTempNTC/10;
-  if (isnan(heaterTempNTC)){
-    heaterTempNTC = -99.9;
-    Serial.println("Failed to read temperature from NTC");
+
+  trendScreen.invalidate(); // the menu pass below clears the framebuffer
+  renderMenu(model);
+  yield();
+  u8g2.sendBuffer();
+}
+
+#ifdef RENDER_BENCHMARK
+// The pre-cache render pass: every line's full text through the font renderer.
+void renderMenuFullText(const DisplayModel& model) {
+  u8g2.clearBuffer();
+  for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
+      int lineStartY = i * LINE_HEIGHT;
+
+      if (i == model.selectedLine) {
+          u8g2.setDrawColor(1);
+          u8g2.drawBox(0, lineStartY, DISPLAY_WIDTH, LINE_HEIGHT);
+          u8g2.setDrawColor(0);
+      }
+      u8g2.setCursor(TEXT_X_OFFSET, text_Y_baselines[i]);
+      u8g2.print(MENU_LABELS[i]);
+      u8g2.print(' ');
+      u8g2.print(model.values[i]);
+      u8g2.setDrawColor(1);
   }
-  
 }
 
-void readSHT30Sensor() { //modified for use with DHT11 instead of SHT30
-    // enclosureTempSHT30 = sht31.readTemperature();
-    // enclosureHumiditySHT30 = sht31.readHumidity();
-
-    sensors_event_t event;
-    dht.temperature().getEvent(&event); 
-    enclosureTempSHT30 = event.temperature;
-    if (! isnan(enclosureTempSHT30)) {  // check if 'is not a number'
-      Serial.print("Temp *C = "); Serial.print(enclosureTempSHT30); Serial.print("\t\t");
-    } else { 
-      enclosureTempSHT30 = -99.0;
-      Serial.println("Failed to read temperature");
-    }
-    
-    dht.humidity().getEvent(&event);
-    enclosureHumiditySHT30 = event.relative_humidity ;
-
-    if (! isnan(enclosureHumiditySHT30)) {  // check if 'is not a number'
-      Serial.print("Hum. % = "); Serial.println(enclosureHumiditySHT30);
-    } 
-    else { 
-      enclosureHumiditySHT30 = -99.0;
-      Serial.println("Failed to read humidity");
-    }
+// Times both render passes into the framebuffer (sendBuffer excluded, it's
+// the same SPI transfer either way) and prints the per-frame cost.
+void runRenderBenchmark() {
+  const int PASSES = 200;
+  DisplayModel model = {};
+  model.selectedLine = 2;
+  const char* const sample[NUM_MENU_ITEMS] = { "~38.4 C", "Dry 1/2  45.0 C", "45.0 C", "60 %", "23.50 %", "71.3 C" };
+  for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
+    snprintf(model.values[i], DISPLAY_VALUE_CHARS, "%s", sample[i]);
+  }
+
+  uint32_t started = micros();
+  for (int n = 0; n < PASSES; ++n) renderMenuFullText(model);
+  uint32_t fullUs = micros() - started;
+
+  started = micros();
+  for (int n = 0; n < PASSES; ++n) renderMenu(model);
+  uint32_t cachedUs = micros() - started;
+
+  started = micros();
+  u8g2.sendBuffer();
+  uint32_t sendUs = micros() - started;
 
+  Serial.printf("Render pass: full text %lu us, cached labels %lu us (%.1fx), sendBuffer %lu us\n",
+                (unsigned long)(fullUs / PASSES), (unsigned long)(cachedUs / PASSES),
+                cachedUs ? (float)fullUs / cachedUs : 0.0f, (unsigned long)sendUs);
 }
+#endif
+
 void setup() {
   // Initialize Serial communication for debugging (optional)
   Serial.begin(115200);
@@ -293,7 +396,10 @@ void setup() {
              text_Y_baselines[i] = u8g2.getDisplayHeight() - (fontMaxHeight - fontAscent);   
         }
     }
-    
+    labelCache.begin(u8g2, LINE_HEIGHT, TEXT_X_OFFSET, text_Y_baselines);
+#ifdef RENDER_BENCHMARK
+    runRenderBenchmark();
+#endif
 
   Serial.println("Display initialized");
   // Wire.begin(); 
@@ -302,18 +408,7 @@ void setup() {
   dht.begin();
   fan.begin();
 
-  ntc_thermistor = new NTC_Thermistor_ESP32(
-        NTC_SENSOR_PIN,
-        NTC_REFERENCE_RESISTANCE,
-        NTC_NOMINAL_RESISTANCE,
-        NTC_NOMINAL_TEMPERATURE,
-        NTC_B_VALUE,
-        NTC_ESP32_ADC_VREF_MV,
-        NTC_ESP32_ANALOG_RESOLUTION
-    );
-
   rotaryEncoder.setEncoderType(FLOATING);
-  rotaryEncoder.setBoundaries(1,3,false);
   // rotaryEncoder.onTurned(&knobCallback);
   // rotaryEncoder.onPressed(buttonCallback);
   pinMode(ENCODER_SW_PIN, INPUT);
@@ -322,182 +417,28 @@ void setup() {
 
   pinMode(RelayPin, OUTPUT);
 
-
+  beginTrace();
+  controllerSetup();
 }
 
 void loop(){
-  
-  // if (turnedRightFlag){
+  uint32_t sincePass = millis() - lastPassMs;
+  if (sincePass < MIN_PASS_MS) delay(MIN_PASS_MS - sincePass);
+  lastPassMs = millis();
 
-  // }
-
-  if (buttonPressedFlag){
-    delay(300);
-    Serial.println("Pressed button");
-    attachInterrupt(ENCODER_SW_PIN, buttonCallback,  FALLING);
-    buttonPressedFlag = false;
-
-
-    if (editingMode){
-      rotaryEncoder.setBoundaries(1,3,true);
-      rotaryEncoder.setEncoderValue(1);
-
-      editingMode = false;
-    }
-    else{
-      selectedLine = (int)rotaryEncoder.getEncoderValue();
-      rotaryEncoder.setBoundaries(-100,100,true);
-      rotaryEncoder.setEncoderValue(0);
-      editingMode = true;
-    }
-    
-    
-    // if (!editingMode){
-    //   if (selectedLine == 1){
-    //     heaterEnabled = true;
-    //   }
-    //   else if (selectedLine == 2) // setting target temperature
-    //   {
-    //     rotaryEncoder.setBoundaries(0,50,true); //can set temperature from zero Celsius to 50 Celsius
-
-    //     while (buttonPressedFlag == false){ // as long as button isn't pressed, can adjust temp, only refreshes that line on screen.
-    //       sprintf(displayBuffer, "Target Temp: %.1f C", rotaryEncoder.getEncoderValue());
-    //       u8g2.setDrawColor(1);
-    //       u8g2.drawBox(0, 2 * LINE_HEIGHT, DISPLAY_WIDTH, LINE_HEIGHT); //2*LineHeight argument b/c second row
-    //       u8g2.setDrawColor(0);
-    //       u8g2.setCursor(TEXT_X_OFFSET, text_Y_baselines[2]);
-    //       u8g2.print(displayBuffer);
-    //       u8g2.setDrawColor(1);
-    //     }
-    //     rotaryEncoder.setBoundaries(1,3,false);
-    //   }
-    //   else{
-    //     rotaryEncoder.setBoundaries(0,50,true); //can set temperature from zero Celsius to 50 Celsius
-
-    //     while (buttonPressedFlag == false){ // as long as button isn't pressed, can adjust temp, only refreshes that line on screen.
-    //       sprintf(displayBuffer, "Target Temp: %.1f C", rotaryEncoder.getEncoderValue());
-    //       u8g2.setDrawColor(1);
-    //       u8g2.drawBox(0, 2 * LINE_HEIGHT, DISPLAY_WIDTH, LINE_HEIGHT); //2*LineHeight argument b/c second row
-    //       u8g2.setDrawColor(0);
-    //       u8g2.setCursor(TEXT_X_OFFSET, text_Y_baselines[2]);
-    //       u8g2.print(displayBuffer);
-    //       u8g2.setDrawColor(1);
-    //     }
-    //     rotaryEncoder.setBoundaries(1,3,false);
-      // }
-      
-    }
-
-  if (!editingMode){
-     selectedLine = (int)rotaryEncoder.getEncoderValue(); 
-    }
-  else{
-      editValues(selectedLine);
-    }
-  // Serial.print("Loop Check -- Before Relay Logic -- ");
-  // Serial.print("heaterEnabled: "); Serial.print(heaterEnabled ? "true" : "false");
-  // Serial.print(" | SHT30 Temp: "); Serial.print(enclosureTempSHT30);
-  // Serial.print(" | Target Temp: "); Serial.print(targetTemperature);
-  // Serial.print(" | Humidity: "); Serial.println(enclosureHumiditySHT30);
-
-  if (heaterEnabled && enclosureHumiditySHT30 > 0 && enclosureTempSHT30 < targetTemperature) {
-    digitalWrite(RelayPin, HIGH);
-    // Serial.println("RELAY DECISION: --- HIGH ---");
-  } 
-  else {
-    digitalWrite(RelayPin, LOW);
-    // Serial.println("RELAY DECISION: --- LOW ---");
-  }
-  
-  if (millis() > lastTime + 200){ //maybe change it so that it redraws those values every 200ms but data is actually logged every loop. This would make reaction to error faster.
-    readSHT30Sensor();
-    readNTCSensor();
-    // unsigned int rpms = fan.getSpeed(); // Send the command to get RPM
-    // byte dutyCycle = fan.getDutyCycle();
-    // Serial.printf("Current speed: %5d RPM | Duty cycle: %3d%%\n", rpms, dutyCycle);
-    lastTime = millis();
-  }
-  
-  // byte target = max(min((int)targetFanSpeed, 100), 0);
-  fan.setDutyCycle(targetFanSpeed);
-    // Print obtained value
-    // Serial.printf("Setting duty cycle: % 3d%%\n", target);
-  // Serial.println("Heater Thermistor Temperature: "); Serial.print(heaterTempNTC); Serial.print("\t\t");
-  // Serial.println("DRAWING");
-  
-
-  // if (buttonWasPressedThisLoop) {
-  //     if (editingMode) {
-  //     }
-  //   }
-  
-  u8g2.firstPage();
-  do {
-      for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
-          int lineStartY = i * LINE_HEIGHT;
-          char prefix = (editingMode && i == editingLine) ? '>' : ' ';
-
-          switch (i) {
-              case 0:
-                  // snprintf(displayBuffer, sizeof(displayBuffer), "%c%s %.1fC", prefix, itemLabels[i], targetTemperature);
-                  sprintf(displayBuffer, "Current Temp: %.1f C", enclosureTempSHT30);
-                  break;
-              case 1:
-                  // snprintf(displayBuffer, sizeof(displayBuffer), "%c%s %d%%", prefix, itemLabels[i], targetFanSpeed);
-                  //Heater on off
-                  if (heaterEnabled){
-                    sprintf(displayBuffer, "Heater ON");
-                  }
-
-                  else{
-                    sprintf(displayBuffer, "Heater OFF");
-                  }
-
-                  break;
-              case 2:
-                  // if (enclosureTempSHT30 <= -99.0) snprintf(displayBuffer, sizeof(displayBuffer), "%c%s --.-C", prefix, itemLabels[i]);
-                  // else snprintf(displayBuffer, sizeof(displayBuffer), "%c%s %.1fC", prefix, itemLabels[i], enclosureTempSHT30);
-                  sprintf(displayBuffer, "Target Temp: %.1f C", targetTemperature);
-                  break;
-              case 3:
-                  
-                sprintf(displayBuffer, "Fan Speed:  %d %%", targetFanSpeed); // Added space for alignment
-              //       if (heaterTempNTC <= -99.0) snprintf(displayBuffer, sizeof(displayBuffer), "%c%s --.-C", prefix, itemLabels[i]);
-              //     else snprintf(displayBuffer, sizeof(displayBuffer), "%c%s %.1fC", prefix, itemLabels[i], heaterTempNTC);
-                  break;
-              case 4:
-                  // if (enclosureHumiditySHT30 <= -99.0) snprintf(displayBuffer, sizeof(displayBuffer), "%c%s --.-%%", prefix, itemLabels[i]);
-                  // else snprintf(displayBuffer, sizeof(displayBuffer), "%c%s %.0f%%", prefix, itemLabels[i], enclosureHumiditySHT30);
-                  sprintf(displayBuffer, "Humidity: %.2f %%", enclosureHumiditySHT30);
-                  break;
-
-              case 5:
-                sprintf(displayBuffer, "Heater Core Temp:  %.1f C", heaterTempNTC);
-                break;
-          }
-
-          if (i == selectedLine) {
-              u8g2.setDrawColor(1);
-              u8g2.drawBox(0, lineStartY, DISPLAY_WIDTH, LINE_HEIGHT);
-              u8g2.setDrawColor(0);
-              u8g2.setCursor(TEXT_X_OFFSET, text_Y_baselines[i]);
-              u8g2.print(displayBuffer);
-              u8g2.setDrawColor(1);
-          } else {
-              u8g2.setDrawColor(1);
-              u8g2.setCursor(TEXT_X_OFFSET, text_Y_baselines[i]);
-              u8g2.print(displayBuffer);
-          }
-          yield(); 
-      }
-  } 
-  while (u8g2.nextPage());
-
-
-  
-  
-  
+  controllerLoop();
 
+  const ControllerOutputs& out = controllerOutputs();
+  traceWriter.outputs(out.relay, out.fanDuty, out.displayHash);
+  if (millis() - lastTraceFlushMs >= TRACE_FLUSH_MS) flushTrace();
+  checkTraceFull();
 
+  renderDisplay(controllerDisplay());
 
+  if (Serial.available()) {
+    char c = Serial.read();
+    if (c == 'd') startDump(TRACE_PATH);
+    else if (c == 'p') startDump(TRACE_PREV_PATH);
   }
+  continueDump();
+}
@@ -0,0 +1,128 @@
+#include <unity.h>
+
+#include "AdaptiveSampler.h"
+
+// same as the NTC sampler in Controller.cpp
+static const uint32_t MIN_MS = 200;
+static const uint32_t MAX_MS = 5000;
+static const float RESOLUTION = 0.2;
+
+// Waits out the current interval, then takes the sample
+static void sampleWhenDue(AdaptiveSampler& s, uint32_t& t, float value) {
+  TEST_ASSERT_FALSE(s.due(t + s.interval() - 1));
+  t += s.interval();
+  TEST_ASSERT_TRUE(s.due(t));
+  s.sampled(t, value);
+}
+
+// A steady reading until the interval has backed off to the maximum
+static void settle(AdaptiveSampler& s, uint32_t& t, float value) {
+  s.sampled(t, value);
+  for (int i = 0; i < 10; ++i) sampleWhenDue(s, t, value);
+  TEST_ASSERT_EQUAL_UINT32(MAX_MS, s.interval());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fast_change(void) {
+  AdaptiveSampler s(MIN_MS, MAX_MS, RESOLUTION);
+  TEST_ASSERT_TRUE(s.due(0)); // nothing taken yet
+  uint32_t t = 0;
+  settle(s, t, 25.0);
+
+  // the heater switched on: straight down to the minimum in one sample
+  sampleWhenDue(s, t, 45.0);
+  TEST_ASSERT_EQUAL_UINT32(MIN_MS, s.interval());
+
+  // a steady 0.5 C/s ramp settles near one resolution step per sample
+  float v = 45.0;
+  for (int i = 0; i < 20; ++i) {
+    v += 0.5 * s.interval() / 1000.0;
+    sampleWhenDue(s, t, v);
+  }
+  TEST_ASSERT_UINT32_WITHIN(50, 400, s.interval());
+}
+
+void test_settles_gradually(void) {
+  AdaptiveSampler s(MIN_MS, MAX_MS, RESOLUTION);
+  uint32_t t = 0;
+  settle(s, t, 25.0);
+  sampleWhenDue(s, t, 45.0);
+  TEST_ASSERT_EQUAL_UINT32(MIN_MS, s.interval());
+
+  // the reading stops moving: at most 2x per sample, until the maximum
+  uint32_t previous = s.interval();
+  int samples = 0;
+  while (s.interval() < MAX_MS) {
+    sampleWhenDue(s, t, 45.0);
+    TEST_ASSERT_GREATER_OR_EQUAL(previous, s.interval());
+    TEST_ASSERT_LESS_OR_EQUAL(2 * previous, s.interval());
+    previous = s.interval();
+    TEST_ASSERT_LESS_THAN(20, ++samples);
+  }
+  sampleWhenDue(s, t, 45.0);
+  TEST_ASSERT_EQUAL_UINT32(MAX_MS, s.interval());
+}
+
+void test_kick(void) {
+  AdaptiveSampler s(MIN_MS, MAX_MS, RESOLUTION);
+  uint32_t t = 0;
+  settle(s, t, 25.0);
+  TEST_ASSERT_FALSE(s.due(t + MIN_MS));
+
+  s.kick();
+  TEST_ASSERT_EQUAL_UINT32(MIN_MS, s.interval());
+  TEST_ASSERT_TRUE(s.due(t + MIN_MS));
+
+  // nothing moved after all, back off again
+  sampleWhenDue(s, t, 25.0);
+  TEST_ASSERT_EQUAL_UINT32(2 * MIN_MS, s.interval());
+}
+
+void test_failed_reads_back_off(void) {
+  AdaptiveSampler s(MIN_MS, MAX_MS, RESOLUTION);
+  uint32_t t = 0;
+  s.sampled(t, 25.0);
+  sampleWhenDue(s, t, 25.0);
+
+  // retry soon once, then double up to the maximum
+  const uint32_t expected[] = { 200, 400, 800, 1600, 3200, 5000, 5000 };
+  for (uint32_t interval : expected) {
+    sampleWhenDue(s, t, -99.9);
+    TEST_ASSERT_EQUAL_UINT32(interval, s.interval());
+  }
+
+  // a good read ends it, the failed ones didn't count as a jump
+  sampleWhenDue(s, t, 25.0);
+  TEST_ASSERT_EQUAL_UINT32(MAX_MS, s.interval());
+  sampleWhenDue(s, t, -99.9);
+  TEST_ASSERT_EQUAL_UINT32(MIN_MS, s.interval());
+  TEST_ASSERT_EQUAL_UINT32(11, s.taken());
+}
+
+void test_skipped_count(void) {
+  AdaptiveSampler s(MIN_MS, MAX_MS, RESOLUTION);
+  s.sampled(0, 25.0);
+  TEST_ASSERT_EQUAL_UINT32(0, s.skipped());
+
+  s.sampled(1000, 25.0); // a fixed poll would have sampled at 200..800 too
+  TEST_ASSERT_EQUAL_UINT32(4, s.skipped());
+  s.sampled(1200, 25.0);
+  TEST_ASSERT_EQUAL_UINT32(4, s.skipped());
+  s.sampled(1300, 25.0); // sooner than the minimum, nothing skipped
+  TEST_ASSERT_EQUAL_UINT32(4, s.skipped());
+  s.sampled(6300, 25.0);
+  TEST_ASSERT_EQUAL_UINT32(28, s.skipped());
+  TEST_ASSERT_EQUAL_UINT32(5, s.taken());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fast_change);
+  RUN_TEST(test_settles_gradually);
+  RUN_TEST(test_kick);
+  RUN_TEST(test_failed_reads_back_off);
+  RUN_TEST(test_skipped_count);
+  return UNITY_END();
+}
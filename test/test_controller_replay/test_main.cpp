@@ -0,0 +1,212 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "Controller.h"
+#include "Hal.h"
+#include "TraceRecorder.h"
+
+// The whole controller recorded through a scripted HAL the way main.cpp
+// records it, then replayed the way tools/replay does. The controller's state
+// lives in globals that can't be reset, so the recording runs in a forked
+// child and the replay gets a fresh controller in the parent.
+
+static const long PASSES = 150000;
+
+static bool replaying;
+
+// --- Recording: a scripted user and a simulated heater and enclosure ---
+
+static TraceWriter writer;
+static FILE* traceFile;
+static uint32_t nowMs = 1000;
+static long encoder;
+static bool button;
+static bool relay;
+static double heaterC = 22.0, enclosureC = 22.0;
+static long pass;
+static uint32_t noise = 12345;
+
+static size_t traceSink(const uint8_t* data, size_t len) {
+  return fwrite(data, 1, len, traceFile);
+}
+
+static int randomBelow(int n) {
+  noise = noise * 1103515245 + 12345; // deterministic, same trace every run
+  return (int)((noise >> 16) % n);
+}
+
+// user: target 40, heater on; later off and the first profile; later the fan
+static void scriptUser() {
+  if (pass == 10) encoder = 2;
+  if (pass == 20 || pass == 80) button = true;
+  if (pass >= 30 && pass < 70) encoder++;
+  if (pass == 90) encoder = 1;
+  if (pass == 100 || pass == 110) button = true;
+  if (pass == 70000) encoder = 1;
+  if (pass == 70010 || pass == 70020 || pass == 70040) button = true;
+  if (pass == 70030) encoder++;
+  if (pass == 120000) encoder = 0;
+  if (pass == 120010) button = true;
+  if (pass > 120020 && pass < 120030) encoder++;
+}
+
+static void recordTrace() {
+  writer.begin(traceSink, 0xFFFFFFFF);
+  controllerSetup();
+  for (pass = 0; pass < PASSES; ++pass) {
+    scriptUser();
+    controllerLoop();
+    const ControllerOutputs& out = controllerOutputs();
+    writer.outputs(out.relay, out.fanDuty, out.displayHash);
+
+    uint32_t dtMs = (pass % 301 == 0) ? 73 : 50; // a late pass now and then
+    nowMs += dtMs;
+    double dtS = dtMs / 1000.0;
+    double heaterRate = (relay ? 0.3 : 0.0) - 0.02 * (heaterC - enclosureC);
+    double enclosureRate = 0.003 * (heaterC - enclosureC) - 0.002 * (enclosureC - 22.0);
+    heaterC += heaterRate * dtS;
+    enclosureC += enclosureRate * dtS;
+  }
+  writer.flush();
+}
+
+// --- Replay ---
+
+static TraceReader reader;
+static long replayedOuts;
+
+static TraceEvent expect(uint8_t type) {
+  TraceEvent ev = reader.next();
+  TEST_ASSERT_EQUAL_MESSAGE(type, ev.type, "the controller read something the trace doesn't have here");
+  return ev;
+}
+
+// --- Hal.h, recording or replaying ---
+
+void halReadLoopInputs(LoopInputs& in) {
+  if (replaying) {
+    TraceEvent ev = expect(TRACE_TICK);
+    in.nowMs = ev.nowMs;
+    in.encoderValue = ev.encoder;
+    in.buttonPressed = ev.button;
+    return;
+  }
+  in.nowMs = nowMs;
+  in.encoderValue = encoder;
+  in.buttonPressed = button;
+  button = false;
+  writer.tick(in.nowMs, in.encoderValue, in.buttonPressed);
+}
+
+uint16_t halReadNtcRaw() {
+  if (replaying) return expect(TRACE_NTC).ntcRaw;
+  double ohms = 114400 * exp(3950 * (1 / (heaterC + 273.15) - 1 / (25.7 + 273.15)));
+  uint16_t raw = (uint16_t)(4095 * ohms / (ohms + 4883) + randomBelow(7) - 3);
+  writer.ntc(raw);
+  return raw;
+}
+
+void halReadDht(float& tempC, float& humidity) {
+  if (replaying) {
+    TraceEvent ev = expect(TRACE_DHT);
+    tempC = ev.tempC;
+    humidity = ev.humidity;
+    return;
+  }
+  bool dropped = randomBelow(50) == 0 || (pass > 90000 && pass < 100000); // and a long outage
+  float spike = randomBelow(100) == 0 ? 15.0 : 0.0;
+  tempC = TraceWriter::quantizeDht(dropped ? NAN : (float)round(enclosureC) + spike);
+  humidity = TraceWriter::quantizeDht(dropped ? NAN : 45.0);
+  writer.dht(tempC, humidity);
+}
+
+void halSetRelay(bool on) {
+  if (!replaying) relay = on;
+}
+
+void halSetFanDuty(int) {}
+
+void halSetEncoderBounds(long minValue, long maxValue, bool) {
+  if (replaying) return;
+  if (encoder < minValue) encoder = minValue;
+  if (encoder > maxValue) encoder = maxValue;
+}
+
+void halSetEncoderValue(long value) {
+  if (!replaying) encoder = value;
+}
+
+void halDelay(uint32_t ms) {
+  if (!replaying) nowMs += ms;
+}
+
+void halLog(const char*, ...) {}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_replay_matches_recording(void) {
+  traceFile = tmpfile();
+  TEST_ASSERT_NOT_NULL(traceFile);
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0) {
+    recordTrace();
+    fflush(traceFile);
+    _exit(writer.truncated() ? 1 : 0);
+  }
+  int status;
+  TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+  TEST_ASSERT_TRUE(WIFEXITED(status));
+  TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+
+  std::vector<uint8_t> data;
+  rewind(traceFile);
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), traceFile)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(traceFile);
+  TEST_ASSERT_TRUE(reader.begin(data.data(), data.size()));
+
+  replaying = true;
+  controllerSetup();
+  ControllerOutputs last = {};
+  bool relayWasOn = false;
+  long passes = 0;
+  while (reader.peek().type == TRACE_TICK) {
+    passes++;
+    controllerLoop();
+
+    // the writer logs OUT only on a change, so a change here must line up with one
+    const ControllerOutputs& out = controllerOutputs();
+    bool changed = replayedOuts == 0 || out.relay != last.relay || out.fanDuty != last.fanDuty
+                   || out.displayHash != last.displayHash;
+    if (changed) {
+      TraceEvent rec = expect(TRACE_OUT);
+      TEST_ASSERT_EQUAL(rec.relay, out.relay);
+      TEST_ASSERT_EQUAL(rec.fanDuty, out.fanDuty);
+      TEST_ASSERT_EQUAL_HEX32(rec.displayHash, out.displayHash);
+      last = out;
+      replayedOuts++;
+      relayWasOn |= out.relay;
+    } else {
+      TEST_ASSERT_NOT_EQUAL(TRACE_OUT, reader.peek().type);
+    }
+  }
+  TEST_ASSERT_EQUAL(TRACE_NONE, reader.peek().type);
+  TEST_ASSERT_EQUAL(PASSES, passes);
+  TEST_ASSERT_TRUE(relayWasOn);
+  TEST_ASSERT_GREATER_THAN(1000, replayedOuts);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_matches_recording);
+  return UNITY_END();
+}
@@ -0,0 +1,125 @@
+#include <unity.h>
+
+#include <math.h>
+
+#include "PredictiveHeater.h"
+
+// Synthetic plant with the same structure as the model
+struct Plant {
+  float heatGain, coreLoss, coupling, encLoss, ambient;
+  float H, E;
+
+  void step(bool relayOn, float dtS) {
+    float dH = (relayOn ? heatGain : 0.0f) - coreLoss * (H - E);
+    float dE = coupling * (H - E) - encLoss * (E - ambient);
+    H += dH * dtS;
+    E += dE * dtS;
+  }
+};
+
+static const Plant ENCLOSURE = { 0.3, 0.02, 0.003, 0.002, 22.0, 22.0, 22.0 };
+static const uint32_t PASS_MS = 200;
+
+static float dhtReading(float E) {
+  return roundf(E * 10.0f) / 10.0f;
+}
+
+// Closed loop as the controller runs it. Returns the highest enclosure
+// temperature seen after fromMs.
+static float runLoop(PredictiveHeater& ph, Plant& plant, bool& relay, uint32_t& t, uint32_t untilMs,
+                     float setpointC, uint32_t fromMs) {
+  float peak = -99.9;
+  for (; t < untilMs; t += PASS_MS) {
+    float E = dhtReading(plant.E);
+    ph.observe(t, plant.H, E, relay);
+    relay = ph.decide(t, setpointC, relay, plant.H, E);
+    plant.step(relay, PASS_MS / 1000.0f);
+    if (t >= fromMs && plant.E > peak) peak = plant.E;
+  }
+  return peak;
+}
+
+static PredictiveHeater trained;
+static Plant trainedPlant;
+static bool trainedRelay;
+static uint32_t trainedT;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_converges_on_plant(void) {
+  trainedPlant = ENCLOSURE;
+  trainedRelay = false;
+  trainedT = 0;
+  TEST_ASSERT_FALSE(trained.trained());
+
+  // a setpoint change every 30 minutes gives the model some excitation
+  for (int i = 0; i < 8; ++i) {
+    runLoop(trained, trainedPlant, trainedRelay, trainedT, (i + 1) * 1800000UL, i % 2 ? 40.0 : 35.0, 0);
+  }
+  TEST_ASSERT_TRUE(trained.trained());
+  TEST_ASSERT_FLOAT_WITHIN(0.3 * 0.15, 0.3, trained.heatGain());
+  TEST_ASSERT_FLOAT_WITHIN(0.02 * 0.15, 0.02, trained.coreLoss());
+  TEST_ASSERT_FLOAT_WITHIN(0.003 * 0.2, 0.003, trained.coupling());
+  TEST_ASSERT_FLOAT_WITHIN(0.002 * 0.3, 0.002, trained.encLoss());
+  TEST_ASSERT_FLOAT_WITHIN(0.002 * 22.0 * 0.3, 0.002 * 22.0, trained.encBias());
+}
+
+void test_cuts_ahead_of_setpoint(void) {
+  TEST_ASSERT_TRUE(trained.trained());
+  uint32_t t = trainedT + 3600000UL; // well clear of the last switch
+
+  // below the setpoint, but the hot core will carry the enclosure past it
+  TEST_ASSERT_GREATER_THAN(40.0, trained.coastPeak(70.0, 39.0));
+  TEST_ASSERT_FALSE(trained.decide(t, 40.0, true, 70.0, 39.0));
+
+  // an untrained controller is plain on/off and keeps heating
+  PredictiveHeater fresh;
+  TEST_ASSERT_TRUE(fresh.decide(t, 40.0, true, 70.0, 39.0));
+}
+
+void test_starts_ahead_of_sag(void) {
+  uint32_t t = trainedT + 7200000UL;
+  // above the setpoint with a cold core: it will sag below the band before
+  // the core has warmed up, so turn on now
+  TEST_ASSERT_TRUE(trained.decide(t, 40.0, false, 40.2, 40.2));
+
+  PredictiveHeater fresh;
+  TEST_ASSERT_FALSE(fresh.decide(t, 40.0, false, 40.2, 40.2));
+}
+
+void test_limits_overshoot(void) {
+  // keep running the trained loop through a step up in setpoint
+  uint32_t start = trainedT;
+  float peak = runLoop(trained, trainedPlant, trainedRelay, trainedT, start + 3600000UL, 45.0, start);
+  TEST_ASSERT_LESS_THAN(45.0 + 1.0, peak);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 45.0, trainedPlant.E);
+}
+
+void test_fast_model_stays_stable(void) {
+  // coefficients where a single 5 s Euler step would blow up
+  const float coreLosses[] = { 0.45, 0.6, 1.0 };
+  for (float coreLoss : coreLosses) {
+    PredictiveHeater ph;
+    ph.setModel(0.3, coreLoss, 0.5, 0.002, 0.044);
+    float peak = ph.coastPeak(60.0, 30.0);
+    TEST_ASSERT_TRUE(isfinite(peak));
+    TEST_ASSERT_TRUE(peak >= 30.0 && peak <= 60.0);
+
+    float E = ph.stepEnclosure(30.0, 60.0, 30.0);
+    TEST_ASSERT_TRUE(E >= 30.0 && E <= 60.0);
+
+    // cold enclosure and core, heater off: must turn on
+    TEST_ASSERT_TRUE(ph.decide(0, 40.0, false, 30.0, 30.0));
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_converges_on_plant);
+  RUN_TEST(test_cuts_ahead_of_setpoint);
+  RUN_TEST(test_starts_ahead_of_sag);
+  RUN_TEST(test_limits_overshoot);
+  RUN_TEST(test_fast_model_stays_stable);
+  return UNITY_END();
+}
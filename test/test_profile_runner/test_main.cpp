@@ -0,0 +1,78 @@
+#include <unity.h>
+
+#include "ThermalProfile.h"
+
+static const ProfileStep STEPS[] = {
+  { 40.0, 10000, 5000 }, // ramp 10 s, hold 5 s
+  { 30.0, 0, 2000 },     // jump down, hold 2 s
+  { 35.0, 4000, 0 },     // ramp 4 s, no hold
+};
+static const Profile TEST_PROFILE = { "Test", STEPS, 3 };
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_ramp_and_hold(void) {
+  ProfileRunner runner;
+  TEST_ASSERT_FALSE(runner.active());
+  runner.start(&TEST_PROFILE, 20.0, 1000);
+  TEST_ASSERT_TRUE(runner.active());
+
+  TEST_ASSERT_EQUAL_FLOAT(20.0, runner.setpointAt(1000));
+  TEST_ASSERT_EQUAL_FLOAT(30.0, runner.setpointAt(6000));
+  TEST_ASSERT_EQUAL_FLOAT(40.0, runner.setpointAt(11000));
+  TEST_ASSERT_EQUAL_FLOAT(40.0, runner.setpointAt(15999));
+  TEST_ASSERT_EQUAL_UINT8(0, runner.currentStep());
+}
+
+void test_step_changes(void) {
+  ProfileRunner runner;
+  runner.start(&TEST_PROFILE, 20.0, 0);
+
+  TEST_ASSERT_EQUAL_FLOAT(30.0, runner.setpointAt(15000)); // zero-length ramp
+  TEST_ASSERT_EQUAL_UINT8(1, runner.currentStep());
+
+  TEST_ASSERT_EQUAL_FLOAT(30.0, runner.setpointAt(17000)); // third step ramps from the second's setpoint
+  TEST_ASSERT_EQUAL_UINT8(2, runner.currentStep());
+  TEST_ASSERT_EQUAL_FLOAT(32.5, runner.setpointAt(19000));
+  TEST_ASSERT_TRUE(runner.active());
+
+  // done: holds the last setpoint and stops
+  TEST_ASSERT_EQUAL_FLOAT(35.0, runner.setpointAt(21000));
+  TEST_ASSERT_FALSE(runner.active());
+  TEST_ASSERT_EQUAL_FLOAT(35.0, runner.setpointAt(50000));
+}
+
+void test_skips_steps_after_a_long_pause(void) {
+  ProfileRunner runner;
+  runner.start(&TEST_PROFILE, 20.0, 0);
+  TEST_ASSERT_EQUAL_FLOAT(33.75, runner.setpointAt(20000)); // straight from step 0 into step 2
+  TEST_ASSERT_EQUAL_UINT8(2, runner.currentStep());
+}
+
+void test_stop(void) {
+  ProfileRunner runner;
+  runner.start(&TEST_PROFILE, 20.0, 0);
+  TEST_ASSERT_EQUAL_FLOAT(30.0, runner.setpointAt(5000));
+  runner.stop();
+  TEST_ASSERT_FALSE(runner.active());
+  TEST_ASSERT_EQUAL_FLOAT(30.0, runner.setpointAt(8000));
+}
+
+void test_builtin_profiles_cool_down(void) {
+  for (int i = 0; i < NUM_BUILTIN_PROFILES; ++i) {
+    const Profile& p = BUILTIN_PROFILES[i];
+    TEST_ASSERT_GREATER_THAN(0, p.numSteps);
+    TEST_ASSERT_LESS_THAN(p.steps[0].setpointC, p.steps[p.numSteps - 1].setpointC);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramp_and_hold);
+  RUN_TEST(test_step_changes);
+  RUN_TEST(test_skips_steps_after_a_long_pause);
+  RUN_TEST(test_stop);
+  RUN_TEST(test_builtin_profiles_cool_down);
+  return UNITY_END();
+}
@@ -0,0 +1,144 @@
+#include <unity.h>
+
+#include <math.h>
+
+#include "SensorPipeline.h"
+
+static const SensorConfig CONFIG = { 45000, 120000, 2.0 }; // same as the DHT channels
+
+// A few readings around 20 C so the filter has a history
+static void settle(SensorChannel& ch, uint32_t& t) {
+  const float readings[] = { 20.0, 20.5, 20.0, 20.2, 19.8 };
+  for (float v : readings) {
+    TEST_ASSERT_TRUE(ch.update(t, v));
+    t += 2000;
+  }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_median(void) {
+  uint16_t codes[] = { 1800, 4095, 1795, 0, 1802 };
+  TEST_ASSERT_EQUAL_UINT16(1800, medianOf(codes, 5));
+  float values[] = { 3.0, 1.0, 4.0, 2.0 };
+  TEST_ASSERT_EQUAL_FLOAT(2.5, medianOf(values, 4));
+}
+
+void test_spike_rejected(void) {
+  SensorChannel ch(CONFIG);
+  uint32_t t = 0;
+  settle(ch, t);
+
+  TEST_ASSERT_FALSE(ch.update(t, 35.0));
+  TEST_ASSERT_EQUAL_FLOAT(19.8, ch.value());
+  TEST_ASSERT_EQUAL(SENSOR_STALE, ch.health(t));
+  TEST_ASSERT_EQUAL_UINT32(1, ch.rejected());
+
+  t += 2000;
+  TEST_ASSERT_TRUE(ch.update(t, 20.1));
+  TEST_ASSERT_EQUAL_FLOAT(20.1, ch.value());
+  TEST_ASSERT_EQUAL(SENSOR_OK, ch.health(t));
+}
+
+void test_step_accepted(void) {
+  SensorChannel ch(CONFIG);
+  uint32_t t = 0;
+  settle(ch, t);
+
+  // a real step: rejected until enough readings agree on the new level
+  TEST_ASSERT_FALSE(ch.update(t, 30.0));
+  t += 2000;
+  TEST_ASSERT_FALSE(ch.update(t, 30.5));
+  t += 2000;
+  TEST_ASSERT_TRUE(ch.update(t, 30.2));
+  TEST_ASSERT_EQUAL_FLOAT(30.2, ch.value());
+  TEST_ASSERT_EQUAL(SENSOR_OK, ch.health(t));
+
+  // the history now follows the new level
+  t += 2000;
+  TEST_ASSERT_TRUE(ch.update(t, 30.4));
+  t += 2000;
+  TEST_ASSERT_FALSE(ch.update(t, 20.0));
+}
+
+void test_ramp_followed(void) {
+  // the NTC during heat-up: 3 C/s at 200 ms samples, from a flat history
+  SensorChannel ch({ 15000, 30000, 1.0 });
+  uint32_t t = 0;
+  for (int i = 0; i < 7; ++i, t += 200) TEST_ASSERT_TRUE(ch.update(t, 25.0));
+
+  int accepted = 0;
+  float trueC = 25.0;
+  for (int i = 0; i < 200; ++i, t += 200) {
+    trueC += 0.6;
+    if (ch.update(t, trueC)) accepted++;
+  }
+  TEST_ASSERT_GREATER_THAN(195, accepted);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, trueC, ch.value());
+  TEST_ASSERT_EQUAL(SENSOR_OK, ch.health(t));
+
+  // faster than the spread allows between two samples, still followed
+  for (int i = 0; i < 20; ++i, t += 200) {
+    trueC -= 2.5;
+    ch.update(t, trueC);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.01, trueC, ch.value());
+
+  // and a spike on the ramp is still rejected
+  TEST_ASSERT_FALSE(ch.update(t, trueC + 40.0));
+}
+
+void test_unrelated_outliers_rejected(void) {
+  SensorChannel ch(CONFIG);
+  uint32_t t = 0;
+  settle(ch, t);
+
+  const float spikes[] = { 35.0, 5.0, 40.0, -10.0, 33.0 };
+  for (float v : spikes) {
+    TEST_ASSERT_FALSE(ch.update(t, v));
+    t += 2000;
+  }
+  TEST_ASSERT_EQUAL_FLOAT(19.8, ch.value());
+  TEST_ASSERT_EQUAL_UINT32(5, ch.rejected());
+
+  // the old history is intact
+  TEST_ASSERT_TRUE(ch.update(t, 20.3));
+}
+
+void test_health(void) {
+  SensorChannel ch(CONFIG);
+  TEST_ASSERT_EQUAL(SENSOR_NO_DATA, ch.health(0));
+  TEST_ASSERT_FALSE(ch.update(0, NAN));
+  TEST_ASSERT_EQUAL(SENSOR_NO_DATA, ch.health(0));
+  TEST_ASSERT_EQUAL_UINT32(1, ch.failedReads());
+
+  TEST_ASSERT_TRUE(ch.update(1000, 21.0));
+  TEST_ASSERT_EQUAL(SENSOR_OK, ch.health(1000));
+  TEST_ASSERT_EQUAL_UINT32(0, ch.ageMs(1000));
+
+  // a failed read makes it stale right away, the last good value stays
+  TEST_ASSERT_FALSE(ch.update(3000, NAN));
+  TEST_ASSERT_EQUAL(SENSOR_STALE, ch.health(3000));
+  TEST_ASSERT_EQUAL_FLOAT(21.0, ch.value());
+
+  TEST_ASSERT_TRUE(ch.update(5000, 21.2));
+  TEST_ASSERT_EQUAL(SENSOR_OK, ch.health(5000));
+
+  // no reads at all: stale after staleMs, failed after failedMs
+  TEST_ASSERT_EQUAL(SENSOR_OK, ch.health(5000 + 45000));
+  TEST_ASSERT_EQUAL(SENSOR_STALE, ch.health(5000 + 45001));
+  TEST_ASSERT_EQUAL(SENSOR_STALE, ch.health(5000 + 120000));
+  TEST_ASSERT_EQUAL(SENSOR_FAILED, ch.health(5000 + 120001));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_median);
+  RUN_TEST(test_spike_rejected);
+  RUN_TEST(test_step_accepted);
+  RUN_TEST(test_ramp_followed);
+  RUN_TEST(test_unrelated_outliers_rejected);
+  RUN_TEST(test_health);
+  return UNITY_END();
+}
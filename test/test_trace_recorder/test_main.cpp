@@ -0,0 +1,249 @@
+#include <unity.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "TraceRecorder.h"
+
+// The sink collects into a fixed buffer; sinkLimit simulates a full partition.
+static uint8_t sinkData[4096];
+static size_t sinkLen;
+static size_t sinkLimit;
+
+static size_t collect(const uint8_t* data, size_t len) {
+  size_t room = sinkLimit - sinkLen;
+  size_t n = len < room ? len : room;
+  memcpy(sinkData + sinkLen, data, n);
+  sinkLen += n;
+  return n;
+}
+
+void setUp(void) {
+  sinkLen = 0;
+  sinkLimit = sizeof(sinkData);
+}
+
+void tearDown(void) {}
+
+// one loop pass the way the controller records it
+static void recordPass(TraceWriter& w, uint32_t nowMs, long encoder, uint16_t ntc) {
+  w.tick(nowMs, encoder, false);
+  w.ntc(ntc);
+  w.outputs(nowMs % 2000 < 1000, 50, nowMs / 1000);
+}
+
+void test_round_trip(void) {
+  TraceWriter w;
+  w.begin(collect, 100000);
+  w.tick(100, 0, false);
+  w.ntc(1800);
+  w.dht(TraceWriter::quantizeDht(23.46), NAN);
+  w.outputs(true, 55, 0xDEADBEEF);
+  w.tick(130, 3, true);
+  w.ntc(1795);
+  w.outputs(true, 55, 0xDEADBEEF); // unchanged, not logged
+  w.tick(5000130UL, -2, false);
+  w.flush();
+  TEST_ASSERT_FALSE(w.truncated());
+  TEST_ASSERT_EQUAL_UINT32(sinkLen, w.bytesWritten());
+
+  TraceReader r;
+  TEST_ASSERT_TRUE(r.begin(sinkData, sinkLen));
+
+  TraceEvent ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_TICK, ev.type);
+  TEST_ASSERT_EQUAL_UINT32(100, ev.nowMs);
+  TEST_ASSERT_EQUAL(0, ev.encoder);
+  TEST_ASSERT_FALSE(ev.button);
+
+  ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_NTC, ev.type);
+  TEST_ASSERT_EQUAL_UINT16(1800, ev.ntcRaw);
+
+  ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_DHT, ev.type);
+  TEST_ASSERT_EQUAL_FLOAT(23.5f, ev.tempC);
+  TEST_ASSERT_TRUE(isnan(ev.humidity));
+
+  ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_OUT, ev.type);
+  TEST_ASSERT_TRUE(ev.relay);
+  TEST_ASSERT_EQUAL(55, ev.fanDuty);
+  TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, ev.displayHash);
+
+  ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_TICK, ev.type);
+  TEST_ASSERT_EQUAL_UINT32(130, ev.nowMs);
+  TEST_ASSERT_EQUAL(3, ev.encoder);
+  TEST_ASSERT_TRUE(ev.button);
+
+  ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_NTC, ev.type);
+  TEST_ASSERT_EQUAL_UINT16(1795, ev.ntcRaw);
+
+  ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_TICK, ev.type);
+  TEST_ASSERT_EQUAL_UINT32(5000130UL, ev.nowMs);
+  TEST_ASSERT_EQUAL(-2, ev.encoder);
+
+  TEST_ASSERT_EQUAL(TRACE_NONE, r.next().type);
+}
+
+void test_rejects_other_data(void) {
+  TraceReader r;
+  const uint8_t notTrace[] = { 'E', 'N', 'C', 'X', 2 };
+  TEST_ASSERT_FALSE(r.begin(notTrace, sizeof(notTrace)));
+
+  TraceWriter w;
+  w.begin(collect, 100000);
+  w.flush();
+  sinkData[4]++; // a version this build doesn't know
+  TEST_ASSERT_FALSE(r.begin(sinkData, sinkLen));
+}
+
+// Reads every event, checks time never goes backwards, returns the count.
+static int countEvents(TraceReader& r, uint32_t& lastNowMs) {
+  int n = 0;
+  lastNowMs = 0;
+  for (TraceEvent ev = r.next(); ev.type != TRACE_NONE; ev = r.next()) {
+    if (ev.type == TRACE_TICK) {
+      TEST_ASSERT_TRUE(ev.nowMs >= lastNowMs);
+      lastNowMs = ev.nowMs;
+    }
+    n++;
+  }
+  return n;
+}
+
+void test_full_at_max_bytes(void) {
+  TraceWriter w;
+  w.begin(collect, 300);
+  uint32_t t = 0;
+  for (int i = 0; i < 500; ++i, t += 30) recordPass(w, t, i / 10, 1800 + i % 5);
+  w.flush();
+
+  TEST_ASSERT_TRUE(w.truncated());
+  TEST_ASSERT_LESS_OR_EQUAL(300, sinkLen);
+  TEST_ASSERT_EQUAL_UINT32(sinkLen, w.bytesWritten());
+
+  // everything up to the cut decodes, the reader stops cleanly at the end
+  TraceReader r;
+  TEST_ASSERT_TRUE(r.begin(sinkData, sinkLen));
+  uint32_t lastNowMs;
+  TEST_ASSERT_GREATER_THAN(50, countEvents(r, lastNowMs));
+  TEST_ASSERT_EQUAL(sinkLen, r.offset());
+}
+
+void test_full_on_short_write(void) {
+  TraceWriter w;
+  w.begin(collect, 100000);
+  sinkLimit = 700; // the partition fills long before maxBytes
+  uint32_t t = 0;
+  for (int i = 0; i < 2000; ++i, t += 30) recordPass(w, t, i / 10, 1800 + i % 5);
+  w.flush();
+
+  TEST_ASSERT_TRUE(w.truncated());
+  TEST_ASSERT_EQUAL(700, sinkLen);
+  TEST_ASSERT_EQUAL_UINT32(sinkLen, w.bytesWritten());
+
+  // the last event may be cut in half, the reader stops in front of it
+  TraceReader r;
+  TEST_ASSERT_TRUE(r.begin(sinkData, sinkLen));
+  uint32_t lastNowMs;
+  TEST_ASSERT_GREATER_THAN(100, countEvents(r, lastNowMs));
+  TEST_ASSERT_LESS_OR_EQUAL(sinkLen, r.offset());
+}
+
+void test_truncated_data(void) {
+  TraceWriter w;
+  w.begin(collect, 100000);
+  uint32_t t = 0;
+  for (int i = 0; i < 100; ++i, t += 30) recordPass(w, t, i / 10, 1800 + i % 5);
+  w.flush();
+
+  TraceReader r;
+  TEST_ASSERT_TRUE(r.begin(sinkData, sinkLen));
+  uint32_t fullLastMs;
+  int fullCount = countEvents(r, fullLastMs);
+
+  // cutting the data anywhere gives a clean prefix of the full trace
+  for (size_t cut = 5; cut < sinkLen; cut += 7) {
+    TEST_ASSERT_TRUE(r.begin(sinkData, cut));
+    uint32_t lastNowMs;
+    int n = countEvents(r, lastNowMs);
+    TEST_ASSERT_TRUE(n < fullCount);
+    TEST_ASSERT_TRUE(lastNowMs <= fullLastMs);
+    TEST_ASSERT_LESS_OR_EQUAL(cut, r.offset());
+  }
+}
+
+// Idle passes at a steady rate, an NTC read every 10th pass and the odd late pass
+static uint32_t recordIdle(TraceWriter& w, int passes, uint32_t* times) {
+  uint32_t t = 1000;
+  for (int i = 0; i < passes; ++i) {
+    t += (i % 97 == 0) ? 51 : 50;
+    times[i] = t;
+    w.tick(t, 0, false);
+    if (i % 10 == 9) w.ntc(1800 + i % 3);
+  }
+  return t;
+}
+
+void test_idle_ticks_compress(void) {
+  static uint32_t times[1000];
+  TraceWriter w;
+  w.begin(collect, 100000);
+  w.tick(1000, 0, false);
+  recordIdle(w, 1000, times);
+  w.tick(times[999] + 50, 2, true); // a busy pass ends the last run
+  w.flush();
+  TEST_ASSERT_LESS_THAN(500, sinkLen); // a REPEAT and the NTC per 10 passes, 2 bytes every pass without
+
+  TraceReader r;
+  TEST_ASSERT_TRUE(r.begin(sinkData, sinkLen));
+  TEST_ASSERT_EQUAL_UINT32(1000, r.next().nowMs);
+  for (int i = 0; i < 1000; ++i) {
+    TraceEvent ev = r.next();
+    TEST_ASSERT_EQUAL(TRACE_TICK, ev.type);
+    TEST_ASSERT_EQUAL_UINT32(times[i], ev.nowMs);
+    TEST_ASSERT_EQUAL(0, ev.encoder);
+    TEST_ASSERT_FALSE(ev.button);
+    if (i % 10 == 9) {
+      ev = r.next();
+      TEST_ASSERT_EQUAL(TRACE_NTC, ev.type);
+      TEST_ASSERT_EQUAL_UINT16(1800 + i % 3, ev.ntcRaw);
+    }
+  }
+  TraceEvent ev = r.next();
+  TEST_ASSERT_EQUAL(TRACE_TICK, ev.type);
+  TEST_ASSERT_EQUAL(2, ev.encoder);
+  TEST_ASSERT_TRUE(ev.button);
+  TEST_ASSERT_EQUAL(TRACE_NONE, r.next().type);
+}
+
+void test_pending_run_written_on_flush(void) {
+  static uint32_t times[200];
+  TraceWriter w;
+  w.begin(collect, 100000);
+  w.tick(1000, 0, false);
+  recordIdle(w, 195, times); // ends inside a run of idle ticks
+  w.flush();
+
+  TraceReader r;
+  TEST_ASSERT_TRUE(r.begin(sinkData, sinkLen));
+  uint32_t lastNowMs;
+  TEST_ASSERT_EQUAL(1 + 195 + 19, countEvents(r, lastNowMs));
+  TEST_ASSERT_EQUAL_UINT32(times[194], lastNowMs);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_rejects_other_data);
+  RUN_TEST(test_full_at_max_bytes);
+  RUN_TEST(test_full_on_short_write);
+  RUN_TEST(test_truncated_data);
+  RUN_TEST(test_idle_ticks_compress);
+  RUN_TEST(test_pending_run_written_on_flush);
+  return UNITY_END();
+}
@@ -0,0 +1,94 @@
+#include <unity.h>
+
+#include "TrendStore.h"
+
+static TrendStore store; // too big to want on the stack
+
+void setUp(void) {
+  store = TrendStore();
+}
+
+void tearDown(void) {}
+
+static void append(uint32_t nowMs, float enclosure, float humidity, float heater) {
+  float values[TREND_CHANNELS] = { enclosure, humidity, heater };
+  store.append(nowMs, values);
+}
+
+void test_bucket_closes_at_slot_end(void) {
+  append(0, 20.0, 40.0, 30.0);
+  append(400, 21.0, 41.0, 31.0);
+  append(800, 22.0, 42.0, 32.0);
+  TEST_ASSERT_EQUAL_UINT32(0, store.closedCount(0));
+  TEST_ASSERT_EQUAL(0, store.size(0));
+
+  append(1000, 25.0, 45.0, 35.0); // first sample of the next slot
+  TEST_ASSERT_EQUAL_UINT32(1, store.closedCount(0));
+  TEST_ASSERT_EQUAL(1, store.size(0));
+  TEST_ASSERT_EQUAL_UINT32(0, store.closedCount(1)); // the minute tier is still open
+
+  TrendBucket b;
+  TEST_ASSERT_TRUE(store.get(0, TREND_ENCLOSURE_TEMP, 0, b));
+  TEST_ASSERT_EQUAL_INT16(200, b.minX10);
+  TEST_ASSERT_EQUAL_INT16(220, b.maxX10);
+  TEST_ASSERT_EQUAL_INT16(210, b.avgX10);
+  TEST_ASSERT_TRUE(store.get(0, TREND_HEATER_TEMP, 0, b));
+  TEST_ASSERT_EQUAL_INT16(310, b.avgX10);
+  TEST_ASSERT_FALSE(store.get(0, TREND_ENCLOSURE_TEMP, 1, b));
+}
+
+void test_ages_and_ring(void) {
+  for (int i = 0; i <= TREND_DEPTH + 10; ++i) append(i * 1000UL, i, 40.0, 30.0);
+  TEST_ASSERT_EQUAL_UINT32(TREND_DEPTH + 10, store.closedCount(0));
+  TEST_ASSERT_EQUAL(TREND_DEPTH, store.size(0));
+
+  TrendBucket b;
+  TEST_ASSERT_TRUE(store.get(0, TREND_ENCLOSURE_TEMP, 0, b));
+  TEST_ASSERT_EQUAL_INT16((TREND_DEPTH + 9) * 10, b.avgX10);
+  TEST_ASSERT_TRUE(store.get(0, TREND_ENCLOSURE_TEMP, TREND_DEPTH - 1, b));
+  TEST_ASSERT_EQUAL_INT16(10 * 10, b.avgX10);
+  TEST_ASSERT_FALSE(store.get(0, TREND_ENCLOSURE_TEMP, TREND_DEPTH, b));
+
+  TEST_ASSERT_EQUAL_UINT32(2, store.closedCount(1)); // 130 s of samples
+}
+
+void test_invalid_readings_leave_a_gap(void) {
+  append(0, 20.0, 40.0, 30.0);
+  append(1000, -99.0, 41.0, 31.0); // enclosure sensor down for this slot
+  append(1500, -99.0, 41.0, 31.0);
+  append(2000, 22.0, 42.0, 32.0);
+  TEST_ASSERT_EQUAL_UINT32(2, store.closedCount(0));
+
+  TrendBucket b;
+  TEST_ASSERT_FALSE(store.get(0, TREND_ENCLOSURE_TEMP, 0, b));
+  TEST_ASSERT_EQUAL_INT16(TREND_EMPTY, b.avgX10);
+  TEST_ASSERT_TRUE(store.get(0, TREND_ENCLOSURE_HUMIDITY, 0, b)); // other channels unaffected
+  TEST_ASSERT_EQUAL_INT16(410, b.avgX10);
+  TEST_ASSERT_TRUE(store.get(0, TREND_ENCLOSURE_TEMP, 1, b));
+  TEST_ASSERT_EQUAL_INT16(200, b.avgX10);
+}
+
+void test_long_gap_closes_one_bucket(void) {
+  append(0, 20.0, 40.0, 30.0);
+  append(10000, 21.0, 41.0, 31.0); // nothing for 10 slots
+  TEST_ASSERT_EQUAL_UINT32(1, store.closedCount(0));
+
+  // the slot grid restarts at the late sample
+  append(10900, 21.0, 41.0, 31.0);
+  TEST_ASSERT_EQUAL_UINT32(1, store.closedCount(0));
+  append(11000, 22.0, 42.0, 32.0);
+  TEST_ASSERT_EQUAL_UINT32(2, store.closedCount(0));
+
+  TrendBucket b;
+  TEST_ASSERT_TRUE(store.get(0, TREND_ENCLOSURE_TEMP, 0, b));
+  TEST_ASSERT_EQUAL_INT16(210, b.avgX10);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket_closes_at_slot_end);
+  RUN_TEST(test_ages_and_ring);
+  RUN_TEST(test_invalid_readings_leave_a_gap);
+  RUN_TEST(test_long_gap_closes_one_bucket);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+// Host-side replay of a recorded input trace through the controller.
+//
+//   replay [-v] [--until MS] trace.bin
+//
+// trace.bin is either the raw file from the ESP32's flash or a serial log
+// containing the 'd'/'p' hex dump (TRACE BEGIN ... TRACE END). Every input the
+// controller asks for comes from the trace, time included, so a pass here is
+// the same pass the firmware ran. Whenever the relay, fan or display changes
+// the result is checked against the OUT events recorded on the device; the
+// first mismatch is reported with the pass number and timestamp so a long
+// field trace can be bisected with --until.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "Controller.h"
+#include "Hal.h"
+#include "TraceRecorder.h"
+
+static TraceReader reader;
+static unsigned long passCount = 0;
+static uint32_t lastTickMs = 0;
+static bool verbose = false;
+
+static const char* const EVENT_NAMES[] = { "end of trace", "TICK", "NTC", "DHT", "OUT" };
+
+static void diverged(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "DIVERGED at pass %lu, t=%lu ms, offset %zu: ", passCount, (unsigned long)lastTickMs, reader.offset());
+  vfprintf(stderr, fmt, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  exit(1);
+}
+
+static TraceEvent expect(uint8_t type) {
+  const TraceEvent& ev = reader.peek();
+  if (ev.type == TRACE_NONE) {
+    // the device stopped recording part way through this pass (trace full)
+    printf("trace ends inside pass %lu at t=%lu ms, stopping there\n", passCount, (unsigned long)lastTickMs);
+    exit(0);
+  }
+  if (ev.type != type) diverged("controller read %s, trace has %s", EVENT_NAMES[type], EVENT_NAMES[ev.type]);
+  return reader.next();
+}
+
+// --- Hal.h from the trace ---
+
+void halReadLoopInputs(LoopInputs& in) {
+  TraceEvent ev = expect(TRACE_TICK);
+  in.nowMs = ev.nowMs;
+  in.encoderValue = ev.encoder;
+  in.buttonPressed = ev.button;
+  lastTickMs = ev.nowMs;
+}
+
+uint16_t halReadNtcRaw() {
+  return expect(TRACE_NTC).ntcRaw;
+}
+
+void halReadDht(float& tempC, float& humidity) {
+  TraceEvent ev = expect(TRACE_DHT);
+  tempC = ev.tempC;
+  humidity = ev.humidity;
+}
+
+void halSetRelay(bool) {}
+void halSetFanDuty(int) {}
+void halSetEncoderBounds(long, long, bool) {}
+void halSetEncoderValue(long) {}
+void halDelay(uint32_t) {}
+
+void halLog(const char* fmt, ...) {
+  if (!verbose) return;
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+}
+
+static bool loadTrace(const char* path, std::vector<uint8_t>& data) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(f);
+
+  if (data.size() >= 4 && memcmp(data.data(), "ENCT", 4) == 0) return true;
+
+  // serial log with a hex dump in it
+  std::string text(data.begin(), data.end());
+  size_t begin = text.find("TRACE BEGIN");
+  size_t end = text.find("TRACE END", begin);
+  if (begin == std::string::npos || end == std::string::npos) return false;
+  // The device keeps logging while it dumps, so only whole hex lines count
+  data.clear();
+  size_t lineStart = text.find('\n', begin);
+  while (lineStart != std::string::npos && lineStart < end) {
+    size_t lineEnd = text.find('\n', lineStart + 1);
+    if (lineEnd == std::string::npos || lineEnd > end) lineEnd = end;
+    std::string line = text.substr(lineStart + 1, lineEnd - lineStart - 1);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    bool hex = !line.empty() && line.size() % 2 == 0 &&
+               line.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos;
+    for (size_t i = 0; hex && i < line.size(); i += 2) {
+      data.push_back((uint8_t)strtoul(line.substr(i, 2).c_str(), nullptr, 16));
+    }
+    lineStart = lineEnd;
+  }
+  return true;
+}
+
+static void printOutputs(const ControllerOutputs& out) {
+  printf("t=%lu pass=%lu relay=%d fan=%d display=%08lx\n", (unsigned long)lastTickMs, passCount,
+         out.relay, out.fanDuty, (unsigned long)out.displayHash);
+  if (!verbose) return;
+  const DisplayModel& d = controllerDisplay();
+  if (d.trendScreen) {
+    printf("    [trend channel %d tier %d]\n", d.trendChannel, d.trendTier);
+    return;
+  }
+  for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
+    printf("  %c %s %s\n", i == d.selectedLine ? '>' : ' ', MENU_LABELS[i], d.values[i]);
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  bool haveUntil = false;
+  uint32_t untilMs = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-v") == 0) verbose = true;
+    else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+      haveUntil = true;
+      untilMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    }
+    else path = argv[i];
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s [-v] [--until MS] trace.bin\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  if (!loadTrace(path, data) || !reader.begin(data.data(), data.size())) {
+    fprintf(stderr, "%s: not a trace, or recorded by an incompatible firmware\n", path);
+    return 2;
+  }
+
+  clock_t started = clock();
+  controllerSetup();
+
+  bool haveOutputs = false;
+  ControllerOutputs last = {};
+  unsigned long changes = 0;
+
+  while (reader.peek().type == TRACE_TICK) {
+    if (haveUntil && reader.peek().nowMs > untilMs) break;
+    passCount++;
+    controllerLoop();
+
+    const ControllerOutputs& out = controllerOutputs();
+    bool changed = !haveOutputs || out.relay != last.relay || out.fanDuty != last.fanDuty
+                   || out.displayHash != last.displayHash;
+    if (changed) {
+      TraceEvent rec = reader.peek();
+      if (rec.type == TRACE_OUT) {
+        reader.next();
+        if (rec.relay != out.relay || rec.fanDuty != out.fanDuty || rec.displayHash != out.displayHash) {
+          diverged("outputs relay=%d fan=%d display=%08lx, device had relay=%d fan=%d display=%08lx",
+                   out.relay, out.fanDuty, (unsigned long)out.displayHash,
+                   rec.relay, rec.fanDuty, (unsigned long)rec.displayHash);
+        }
+      } else if (rec.type != TRACE_NONE) {
+        diverged("outputs changed here but the device recorded no change");
+      }
+      printOutputs(out);
+      last = out;
+      haveOutputs = true;
+      changes++;
+    } else if (reader.peek().type == TRACE_OUT) {
+      diverged("device outputs changed here but the replay's didn't");
+    }
+  }
+
+  double wallS = (double)(clock() - started) / CLOCKS_PER_SEC;
+  double simS = lastTickMs / 1000.0;
+  printf("replayed %lu passes, %.1f s of device time in %.3f s (%.0fx real time), %lu output changes, all matched\n",
+         passCount, simS, wallS, wallS > 0 ? simS / wallS : 0.0, changes);
+  return 0;
+}